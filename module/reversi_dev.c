@@ -0,0 +1,2763 @@
+/* file: reversi_dev.c
+* author: Caleb M. McLaren
+* email: mclaren1@umbc.edu
+* date: April 23rd, 2021
+* description: This linux character device driver must implement the game reversi
+*	a.k.a. Othello. The game itself lives in reversi_engine.c.
+*/
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>   /* needed by all modules, for THIS_MODULE*/
+#include <linux/kernel.h>   /* KERN_INFO and copy_from_user*/
+#include <linux/init.h>     /* for __init and __exit*/
+#include <linux/err.h>      /* for IS_ERR*/
+#include <linux/cdev.h>     /* for embedding cdev in reversi_data, code defined at fs/char_dev.c, includes kdev_t.h */
+#include <linux/fs.h>       /* for file_operations */
+#include <linux/mutex.h>	/* per session lock */
+#include <linux/spinlock.h>	/* per node session table lock */
+#include <linux/list.h>		/* per node session table */
+#include <linux/atomic.h>	/* per node stats */
+#include <linux/moduleparam.h>	/* for nr_devices */
+#include <linux/device.h>	/* needed for device_create etc */
+#include <linux/slab.h> 	/* for kcalloc, kfree and the session cache*/
+#include <linux/ctype.h>	/* needed for isspace */
+#include <linux/uaccess.h>	/* copy_from_user */
+#include <linux/errno.h> 	/* for ERRORs */
+#include <linux/ktime.h>	/* search deadline */
+#include <linux/timekeeping.h>	/* ktime_get */
+#include <linux/workqueue.h>	/* computer moves searched off the writer's thread */
+#include <linux/wait.h>		/* readers waiting on a computer move */
+#include <linux/poll.h>		/* poll/epoll readiness */
+#include <linux/mm.h>		/* board page mapped into user space */
+#include <linux/firmware.h>	/* opening book and evaluation weights */
+#include <linux/percpu.h>	/* per node stats */
+#include <linux/debugfs.h>	/* stats and latency histograms */
+#include <linux/seq_file.h>	/* debugfs stats file */
+#include <linux/math64.h>	/* nodes per second */
+#include <linux/xarray.h>	/* per node table of games spectators can watch */
+#include <linux/seqlock.h>	/* spectator board snapshots */
+#include <linux/kref.h>		/* spectators outlive the player's session */
+#include <linux/rcupdate.h>	/* game ID lookups without a lock */
+#include <linux/completion.h>	/* searches waiting for a slot */
+#include <linux/capability.h>	/* CAP_SYS_NICE for the interactive class */
+#include <linux/sched/signal.h>	/* batch evaluations stop on a signal */
+#include "reversi_ioctl.h"	/* binary command interface */
+#include "reversi_engine.h"	/* board, move generation and search */
+#define CREATE_TRACE_POINTS
+#include "reversi_trace.h"	/* session, command and search tracepoints */
+#include <linux/bitops.h>	/* for hweight64 and __ffs64 on bitboards */
+#include <linux/cpumask.h>	/* num_online_cpus */
+#include <linux/init.h>		/* for MAJOR*/
+
+#define REVERSI_MAX_MINORS	64
+#define DEVICE_NAME "reversi"
+#define DEVICE_CLASS "reversiClass"
+#define AUTHOR "Caleb M. McLaren <mclaren1@umbc.edu>"
+#define MOD_DESCRIPTION "The game reversi, a.k.a Othello."
+#define COM00 "00\0"
+#define COM01 "01\0"
+#define COM02 "02\0"
+#define COM03 "03\0"
+#define COM04 "04\0"
+#define COM05 "05\0"
+#define WIN "WIN\n"
+#define TIE "TIE\n"
+#define LOSE "LOSE\n"
+#define OK "OK\n"
+#define NOGAME "NOGAME\n"
+#define ILLMOVE "ILLMOVE\n"
+#define OOT "OOT\n"
+#define UNKCMD "UNKCMD\n"
+#define INVFMT "INVFMT\n"
+#define TIMEOUT "TIMEOUT\n"
+#define CMD_MAX 32	/* longest single text command accepted, "02 7 7\n" needs 7 */
+#define RESP_MAX 2048	/* unread responses queued per session */
+#define INPUT_MAX 512	/* written commands waiting to run per session */
+#define MOVE_PENDING (-1)	/* computer move or perft handed to the workqueue, result comes later */
+/* stats kinds, one per command and one for batch evaluations, then anything answered INVFMT or UNKCMD */
+#define STAT_NEW_GAME 0
+#define STAT_GET_BOARD 1
+#define STAT_HUMAN_MOVE 2
+#define STAT_COMPUTER_MOVE 3
+#define STAT_PASS 4
+#define STAT_PERFT 5
+#define STAT_EVALUATE 6
+#define STAT_ERROR 7
+#define STAT_KINDS 8
+#define LATENCY_BUCKETS 40	/* log2 of ns, the last bucket takes anything over ~9 minutes */
+#define MAX_TOKENS 5	/* command, up to two arguments, end marker, spare for no newline */
+#define SEARCH_THREADS_MAX 64	/* helpers beside the searching thread fit one u64 mask */
+#define PERFT_MAX_DEPTH 11	/* "05 11" already walks over 200 million positions, search_time_ms stops it first */
+#define SEARCH_TIME_DEFAULT_MS 100	/* search_time_ms, and what a search gets while no budget is set */
+#define ENDGAME_EMPTIES_MAX 20	/* deepest exact solve, bounds the solver's recursion on the kernel stack */
+#define PONDER_REPLIES 8	/* human replies searched ahead while it thinks, likeliest first */
+#define QOS_CLASSES 3	/* REVERSI_QOS_INTERACTIVE through REVERSI_QOS_BULK */
+#define EVAL_CHUNK (PAGE_SIZE / sizeof(struct reversi_ioc_position))	/* batch positions copied in and out at a time */
+#define SCHED_STRIDE 1024	/* pass a class gains per slot is SCHED_STRIDE / its weight */
+#define SCHED_URGENT_MS 10	/* with slicing off, how close to its deadline a waiting search jumps the queue */
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR(AUTHOR);
+MODULE_DESCRIPTION(MOD_DESCRIPTION);
+
+/*
+* Gobal Variables
+*/ 
+static struct class *reversi_class = NULL;
+static dev_t majMinor;
+static unsigned int nr_devices = 1;
+module_param(nr_devices, uint, 0444);
+MODULE_PARM_DESC(nr_devices, "Number of /dev/reversiN nodes, each with its own sessions (default 1, a single node is named /dev/reversi)");
+static unsigned int search_time_ms = SEARCH_TIME_DEFAULT_MS;
+module_param(search_time_ms, uint, 0644);
+MODULE_PARM_DESC(search_time_ms, "Wall clock budget per computer move in ms, 0 for none while search_nodes is set, else 100 (default 100)");
+static unsigned long search_nodes = 0;
+module_param(search_nodes, ulong, 0644);
+MODULE_PARM_DESC(search_nodes, "Node budget per computer move, 0 for none (default 0)");
+static unsigned int search_depth = 60;
+module_param(search_depth, uint, 0644);
+MODULE_PARM_DESC(search_depth, "Deepest iteration the computer searches (default 60)");
+static unsigned int search_threads = 1;
+module_param(search_threads, uint, 0644);
+MODULE_PARM_DESC(search_threads, "Threads searching each computer move, sharing the transposition table, capped at the online CPUs (default 1)");
+static bool ponder = false;
+module_param(ponder, bool, 0644);
+MODULE_PARM_DESC(ponder, "Search the computer's answers to the human's likeliest replies while the human thinks (default off)");
+static unsigned int search_slots = 0;
+module_param(search_slots, uint, 0644);
+MODULE_PARM_DESC(search_slots, "Search threads running at once across all sessions, each Lazy SMP helper taking a slot of its own, 0 for one per online CPU (default 0)");
+static unsigned int search_slice_ms = 25;
+module_param(search_slice_ms, uint, 0644);
+MODULE_PARM_DESC(search_slice_ms, "Longest a search holds its slot while others wait, 0 to never yield (default 25)");
+static unsigned int endgame_empties = 12;
+module_param(endgame_empties, uint, 0644);
+MODULE_PARM_DESC(endgame_empties, "Empty squares at or below which the computer solves the game exactly, 0 never, larger values act as 20 (default 12)");
+static char * book_file = "reversi_book.bin";
+module_param(book_file, charp, 0444);
+MODULE_PARM_DESC(book_file, "Opening book firmware file read at load time, empty for none (default reversi_book.bin)");
+static char * eval_file = "reversi_eval.bin";
+module_param(eval_file, charp, 0444);
+MODULE_PARM_DESC(eval_file, "Pattern evaluation weights firmware file read at load time, empty for none (default reversi_eval.bin)");
+static unsigned int max_games = 4096;
+module_param(max_games, uint, 0644);
+MODULE_PARM_DESC(max_games, "Games one open file can create with REVERSI_IOC_CREATE besides its own (default 4096)");
+static unsigned int tt_size_mb = 16;
+module_param(tt_size_mb, uint, 0444);
+MODULE_PARM_DESC(tt_size_mb, "Size of the transposition table shared by all sessions in MiB, 0 disables it (default 16)");
+
+/*
+* Prototypes - have to be before file operations for some reason.
+*/
+/* Parsing*/
+size_t count_spaces(const char *str);
+void flush_string( char * cp);
+void simpleParse(char * theCmd, char * tokenArray []);
+
+/*Search*/
+struct search_ticket;
+int searchBestMove(struct reversi_search * search, const struct reversi_board * board, int player,
+		struct search_ticket * ticket);
+
+/*VFS*/
+struct reversi_session;
+struct reversi_data;
+static int reversi_open(struct inode *inode, struct file *f);
+static int reversi_release(struct inode *inode, struct file *f);
+static ssize_t reversi_read(struct file *f, char __user *buf, size_t len, loff_t *off);
+static ssize_t reversi_write(struct file *f, const char __user *cmd, size_t len, loff_t *off);
+static __poll_t reversi_poll(struct file *f, poll_table *wait);
+static int reversi_mmap(struct file *f, struct vm_area_struct *vma);
+static int reversi_command(struct reversi_session * s, char * the_cmd);
+static void runPendingCommands(struct reversi_session * s);
+static void recordCommand(struct reversi_data * node, int kind, u64 ns);
+static void recordSearch(struct reversi_data * node, const struct reversi_search * search, u64 ns);
+static void queueResponse(struct reversi_session * s, const char * response);
+static void publishBoard(struct reversi_session * s);
+static void releaseView(struct kref *ref);
+static struct reversi_session * allocSession(struct reversi_data * node);
+static void freeSession(struct reversi_session * s);
+static void releaseGame(struct kref *ref);
+static void fillGameState(struct reversi_session * s, struct reversi_ioc_game * game);
+static void computerMoveWork(struct work_struct *work);
+static void perftWork(struct work_struct *work);
+static int ponderHit(struct reversi_session * s);
+static void startPonder(struct reversi_session * s);
+static void ponderWork(struct work_struct *work);
+static long reversi_ioctl(struct file *f, unsigned int cmd, unsigned long arg);
+
+/* define file_operations */
+const struct file_operations reversi_fops = {
+	.owner = THIS_MODULE,
+ 	.read = reversi_read,
+ 	.write = reversi_write,
+ 	.poll = reversi_poll,
+ 	.mmap = reversi_mmap,
+ 	.open = reversi_open,
+ 	.release = reversi_release,
+ 	.unlocked_ioctl = reversi_ioctl,
+ 	.compat_ioctl = compat_ptr_ioctl
+};
+
+/*
+* stats of one node on one CPU, summed over CPUs when read,
+* so counting never bounces a cache line between CPUs
+*/
+struct reversi_stats {
+	u64 commands[STAT_KINDS]; /* text commands and ioctls alike */
+	u64 latency[STAT_KINDS][LATENCY_BUCKETS]; /* bucket n counts 2^n to 2^(n+1) - 1 ns */
+	u64 searches; /* computer moves */
+	u64 searchNodes;
+	u64 searchNs;
+	u64 ponderSearches; /* human replies searched ahead */
+	u64 ponderHits; /* computer moves answered from one of them */
+	u64 evalPositions; /* positions through REVERSI_IOC_EVALUATE */
+	u64 sessionAllocs;
+	u64 sessionFrees;
+	u64 allocFailures;
+};
+
+struct reversi_data {
+	/*
+	* recall that include/linux/cdev has four structs inside
+	* kobjects, module, file_operations, list_head
+	* WE USE FILE_OPERATIONS inside reversi_cdev
+	* and cdev structs are used by the kernel to represent char devices internally
+	*/
+	struct cdev reversi_cdev;
+	struct device * dev; /* NULL until device_create succeeds for this minor */
+	spinlock_t lock; /* guards sessions, never held across a command */
+	struct list_head sessions; /* every session open on this node */
+	struct xarray views; /* game ID to struct reversi_view, for spectators */
+	/* stats, shown in /sys/class/reversiClass/reversiN/ */
+	atomic_t activeSessions;
+	atomic_long_t opens;
+	atomic_long_t commands;
+	atomic_long_t games;
+	atomic_t spectators;
+	struct reversi_stats __percpu * stats; /* in debugfs reversi/<node> and partly in sysfs */
+};
+
+/* debugfs reversi/, one stats file per node */
+static struct dentry * debugfsDir;
+
+/* one entry per minor, nr_devices long */
+static struct reversi_data * devs;
+
+/* sessions, board included, charged to the opener's memory cgroup */
+static struct kmem_cache * session_cache;
+
+/* computer move searches, unbound so long searches spread over every CPU */
+static struct workqueue_struct * reversi_wq;
+/* Lazy SMP helpers, kept apart so a search queued on reversi_wq never waits behind its own helpers */
+static struct workqueue_struct * search_wq;
+
+/*
+* What spectators of one game see, rewritten by the player's publishBoard
+* and read under the seqlock without ever taking the session lock, so
+* any number of spectators cost the player one uncontended spinlock per
+* board change. Held by the player's session and by each spectator, and
+* freed after an RCU grace period so game ID lookups need no lock.
+*/
+struct reversi_view {
+	seqlock_t lock; /* the player is the only writer */
+	u64 black;
+	u64 white;
+	u8 inGame;
+	u8 human;
+	u8 nextPlayer; /* REVERSI_* colour or REVERSI_NONE */
+	u32 version; /* bumped by every board change */
+	int closed; /* set once the player's session is released */
+	u32 id; /* index in node->views */
+	wait_queue_head_t wait; /* spectators waiting for the next version */
+	struct kref ref;
+	struct rcu_head rcu;
+};
+
+/* the computer's answer to one human reply, searched while the human thought */
+struct ponder_reply {
+	u64 discs[2]; /* board after the reply */
+	int move;
+};
+
+/*
+* One game per open file, allocated in reversi_open and hung off
+* f->private_data, so every client plays its own board. The same
+* struct holds each further game the file creates by ioctl, those
+* games being driven by REVERSI_IOC_GAME alone.
+*/
+struct reversi_session {
+	struct mutex lock; /* serialises commands and reads on this game */
+	struct reversi_data * node; /* minor this session was opened on */
+	struct list_head node_entry; /* on node->sessions */
+	struct reversi_board the_board;
+	int inGame; /* 0 until "00" deals a board and again once the game is decided */
+	int humanToken;
+	int computerToken;
+    int prevPlayer;
+    int score; 
+	/* responses of every command run since the last read, in command order */
+	size_t responseLen;
+	char response[RESP_MAX];
+	/*
+	* "03" searches in moveWork and "05" counts in perftWork while busy
+	* is set. Commands written meanwhile wait their turn in input, so
+	* the board holds still and responses keep command order.
+	*/
+	struct work_struct moveWork;
+	struct work_struct perftWork;
+	unsigned int perftDepth; /* plies "05" asked perftWork for */
+	wait_queue_head_t readq; /* woken when busy clears or responses or input room appear */
+	int busy;
+	size_t inputLen;
+	char input[INPUT_MAX]; /* whole commands, each ending in a newline */
+	/* own zeroed page, mapped read only by reversi_mmap and rewritten by publishBoard, NULL for created games */
+	struct reversi_mmap_board * shared;
+	u64 moveQueued; /* ktime_get_ns when moveWork or perftWork was queued, for its latency */
+	/* pondering, see ponderWork */
+	struct work_struct ponderWork;
+	int ponderStop; /* set once the human moves, cuts the ponder search short */
+	int ponderLen;
+	struct ponder_reply ponder[PONDER_REPLIES]; /* under lock */
+	int qos; /* REVERSI_QOS_* class of this game's searches */
+	struct reversi_view * view; /* NULL until REVERSI_IOC_GAME_ID shares the game */
+	/* spectators only, set once by REVERSI_IOC_WATCH, the rest of the session goes unused */
+	struct reversi_view * watching;
+	u32 seen; /* version of watching last read */
+	/* games created on this file, ID to session, looked up under RCU */
+	struct xarray games;
+	atomic_t nrGames;
+	/* created games only, held by games and by each ioctl using the game */
+	struct kref ref;
+	struct rcu_head rcu; /* freed after lookups that may still see it */
+};
+
+/*
+* helper/game functions
+*/
+
+/* 
+* Copied from project 1, file utils.c. 
+* Utils.c was provided by CMSC 421 project creators, 
+* Spring 2021, UMBC
+ */
+size_t count_spaces(const char *str) {
+    size_t rv = 0;
+
+    while(*str) {
+        if(isspace(*str++))
+            ++rv;
+    }
+
+    return rv;
+}
+
+/*
+* Copied from project 1, file main.c. 
+* Original authored by Caleb M. McLaren (myself) for project 1,
+* CMSC 421, Spring 2021, UMBC.
+*/
+void flush_string( char * cp){
+	char * temp; 
+	if( (temp = strchr(cp, '\n')) != NULL)
+    *temp = '\0';
+}
+
+/*simple parse*/
+void simpleParse(char * theCmd, char ** tokenArray){
+	char * temp;
+	int i = 0; 
+	flush_string(theCmd);
+	pr_debug("command \"%s\"\n", theCmd);
+
+	while((temp = strsep(&theCmd, " ")) != NULL){
+		tokenArray[i] = temp;
+		i++;
+	}
+	/*empty token marks the end, callers compare against term*/
+	tokenArray[i] = "";
+}
+
+/*
+* take in the device to load against,
+* read book_file through request_firmware into the engine's opening book.
+* A missing or malformed book only means every move is searched.
+*/
+static void loadOpeningBook(struct device * dev) {
+	const struct firmware * fw;
+	int count;
+
+	if (book_file == NULL || book_file[0] == '\0') {
+		return;
+	}
+	if (firmware_request_nowarn(&fw, book_file, dev)) {
+		printk(KERN_INFO "Reversi found no opening book %s, searching every move\n", book_file);
+		return;
+	}
+	count = parseOpeningBook(fw->data, fw->size);
+	release_firmware(fw);
+	if (count == -ENOMEM) {
+		printk(KERN_WARNING "Reversi could not allocate the opening book, searching every move\n");
+	} else if (count < 0) {
+		printk(KERN_WARNING "Reversi opening book %s is malformed, searching every move\n", book_file);
+	} else {
+		printk(KERN_INFO "Reversi opening book %s loaded, %d positions\n", book_file, count);
+	}
+}
+
+/*
+* take in the device to load against,
+* read eval_file through request_firmware into the engine's weights.
+* Without it evaluateBoard falls back to square weights and mobility.
+*/
+static void loadEvalWeights(struct device * dev) {
+	const struct firmware * fw;
+	int err;
+
+	if (eval_file == NULL || eval_file[0] == '\0') {
+		return;
+	}
+	if (firmware_request_nowarn(&fw, eval_file, dev)) {
+		printk(KERN_INFO "Reversi found no evaluation weights %s, using square weights\n", eval_file);
+		return;
+	}
+	err = parseEvalWeights(fw->data, fw->size);
+	release_firmware(fw);
+	if (err == -ENOMEM) {
+		printk(KERN_WARNING "Reversi could not allocate evaluation weights, using square weights\n");
+	} else if (err) {
+		printk(KERN_WARNING "Reversi evaluation weights %s are malformed, using square weights\n", eval_file);
+	} else {
+		printk(KERN_INFO "Reversi evaluation weights %s loaded\n", eval_file);
+	}
+}
+
+/*
+* Search scheduler. At most search_slots search threads run at once,
+* helpers included, each only in a slot nobody waits for; the rest
+* wait in one queue per QoS class, earliest deadline first. A freed slot goes first to the
+* interactive or normal search whose time budget runs out soonest,
+* once that is less than a slice away, so no latency class spends its
+* whole budget queued. Otherwise classes share slots by stride
+* scheduling, interactive:normal:bulk weighted 16:4:1, so bulk work
+* still progresses under load. A search that has run search_slice_ms
+* gives its slot back as soon as anyone waits.
+*/
+static const unsigned int QOS_WEIGHTS[QOS_CLASSES] = { 16, 4, 1 };
+static const char * const QOS_NAMES[QOS_CLASSES] = { "interactive", "normal", "bulk" };
+
+struct search_ticket {
+	struct list_head entry; /* on sched.queue[qos], by deadline, while waiting */
+	struct completion granted;
+	ktime_t deadline; /* when the search's time budget runs out, KTIME_MAX for none */
+	int qos; /* REVERSI_QOS_* */
+	int ponder; /* never waits, gives its slot up to anyone waiting */
+	int preempted; /* ponder only, search cut short for want of a slot */
+};
+
+static struct {
+	spinlock_t lock;
+	unsigned int running;
+	unsigned int queued[QOS_CLASSES];
+	unsigned int queuedAll; /* read without the lock to decide whether to yield */
+	struct list_head queue[QOS_CLASSES];
+	u64 pass[QOS_CLASSES];
+	u64 vtime; /* pass of the class served last, where a class waking up starts */
+	unsigned long granted[QOS_CLASSES]; /* slots handed to each class, for sysfs */
+} sched;
+
+static unsigned int searchSlots(void)
+{
+	unsigned int slots = READ_ONCE(search_slots);
+
+	return slots ? slots : num_online_cpus();
+}
+
+/*
+* called with sched.lock held.
+* return the waiting search to run next and take it off its queue, or NULL
+*/
+static struct search_ticket * pickSearch(void)
+{
+	struct search_ticket * t, * best = NULL;
+	ktime_t urgent;
+	int qos;
+
+	urgent = ktime_add_ms(ktime_get(), READ_ONCE(search_slice_ms) ? READ_ONCE(search_slice_ms) : SCHED_URGENT_MS);
+	for (qos = 0; qos < REVERSI_QOS_BULK; qos++) {
+		t = list_first_entry_or_null(&sched.queue[qos], struct search_ticket, entry);
+		if (t != NULL && ktime_before(t->deadline, urgent) &&
+				(best == NULL || ktime_before(t->deadline, best->deadline))) {
+			best = t;
+		}
+	}
+	if (best == NULL) {
+		for (qos = 0; qos < QOS_CLASSES; qos++) {
+			if (!list_empty(&sched.queue[qos]) && (best == NULL || sched.pass[qos] < sched.pass[best->qos])) {
+				best = list_first_entry(&sched.queue[qos], struct search_ticket, entry);
+			}
+		}
+		if (best == NULL) {
+			return NULL;
+		}
+	}
+	qos = best->qos;
+	sched.vtime = sched.pass[qos];
+	sched.pass[qos] += SCHED_STRIDE / QOS_WEIGHTS[qos];
+	list_del(&best->entry);
+	sched.queued[qos]--;
+	WRITE_ONCE(sched.queuedAll, sched.queuedAll - 1);
+	sched.granted[qos]++;
+	return best;
+}
+
+/*
+* take in ticket with its qos and deadline set,
+* wait for a search slot, in the caller's turn
+*/
+static void getSearchSlot(struct search_ticket * t)
+{
+	struct search_ticket * pos;
+
+	spin_lock(&sched.lock);
+	if (sched.running < searchSlots() && sched.queuedAll == 0) {
+		sched.running++;
+		sched.granted[t->qos]++;
+		spin_unlock(&sched.lock);
+		return;
+	}
+	init_completion(&t->granted);
+	/*a class that sat idle banks no credit*/
+	if (list_empty(&sched.queue[t->qos])) {
+		sched.pass[t->qos] = max(sched.pass[t->qos], sched.vtime);
+	}
+	/*earliest deadline first within a class, a search back from its slice usually goes ahead*/
+	list_for_each_entry_reverse(pos, &sched.queue[t->qos], entry) {
+		if (!ktime_before(t->deadline, pos->deadline)) {
+			break;
+		}
+	}
+	list_add(&t->entry, &pos->entry);
+	sched.queued[t->qos]++;
+	WRITE_ONCE(sched.queuedAll, sched.queuedAll + 1);
+	spin_unlock(&sched.lock);
+	/*bounded by the searches queued ahead, each bounded by its budget*/
+	wait_for_completion(&t->granted);
+}
+
+/*
+* take a slot only if one is free and nobody waits for it.
+* return true when taken
+*/
+static bool tryGetSearchSlot(void)
+{
+	bool taken = false;
+
+	spin_lock(&sched.lock);
+	if (sched.running < searchSlots() && sched.queuedAll == 0) {
+		sched.running++;
+		taken = true;
+	}
+	spin_unlock(&sched.lock);
+	return taken;
+}
+
+/*
+* called with sched.lock held after slots are given back,
+* hand every slot search_slots now allows to the searches picked to run next
+*/
+static void grantSearchSlots(void)
+{
+	struct search_ticket * t;
+
+	while (sched.running < searchSlots() && (t = pickSearch()) != NULL) {
+		sched.running++;
+		complete(&t->granted);
+	}
+}
+
+/*
+* give a slot back, handing it and any others search_slots now allows
+* to the searches picked to run next
+*/
+static void putSearchSlot(void)
+{
+	spin_lock(&sched.lock);
+	sched.running--;
+	grantSearchSlots();
+	spin_unlock(&sched.lock);
+}
+
+/*
+* take in ticket of a search stopped at the end of its slice for others waiting.
+* return true to search on once a slot comes round again,
+* or false when a ponder search should stop
+*/
+static bool yieldSearchSlot(struct search_ticket * t)
+{
+	if (t->ponder) {
+		t->preempted = 1;
+		return false;
+	}
+	putSearchSlot();
+	getSearchSlot(t);
+	return true;
+}
+
+/*
+* one Lazy SMP helper. It searches the same position as the main search
+* only to fill the shared transposition table, its own result is dropped.
+*/
+struct search_helper {
+	struct work_struct work;
+	struct reversi_search search;
+	struct reversi_board board;
+	int player;
+	unsigned int firstDepth;
+};
+
+/*
+* helpers of every search, preallocated so none allocates on the way to
+* a move. Bit n of helpersBusy is set while searchHelpers[n] is taken,
+* under sched.lock since each also holds a search slot.
+*/
+static struct search_helper searchHelpers[SEARCH_THREADS_MAX - 1];
+static u64 helpersBusy;
+
+static void searchHelperWork(struct work_struct *work)
+{
+	struct search_helper * h = container_of(work, struct search_helper, work);
+
+	deepenSearch(&h->search, &h->board, h->player, h->firstDepth);
+}
+
+/*
+* take in how many helpers a search wants,
+* take up to that many free ones, each with a search slot nobody waits for,
+* so helpers never push a waiting search back or run past search_slots.
+* return mask of the searchHelpers taken, fewer or none only costs depth
+*/
+static u64 getHelpers(unsigned int want)
+{
+	u64 taken = 0, free;
+
+	spin_lock(&sched.lock);
+	free = ~helpersBusy & (BIT_ULL(SEARCH_THREADS_MAX - 1) - 1);
+	for (; want > 0 && free && sched.running < searchSlots() && sched.queuedAll == 0; want--) {
+		taken |= free & -free;
+		free &= free - 1;
+		sched.running++;
+	}
+	helpersBusy |= taken;
+	spin_unlock(&sched.lock);
+	return taken;
+}
+
+/*
+* take in mask from getHelpers, once their work is flushed,
+* give them back with their slots
+*/
+static void putHelpers(u64 taken)
+{
+	if (taken == 0) {
+		return;
+	}
+	spin_lock(&sched.lock);
+	helpersBusy &= ~taken;
+	sched.running -= hweight64(taken);
+	grantSearchSlots();
+	spin_unlock(&sched.lock);
+}
+
+/*
+* take in search from initSearch, board, player with at least one legal move,
+* and ticket with qos and deadline set.
+* play the book move when there is one, hand positions with few enough
+* empties to solveBestMove, else deepen on this thread while
+* as many of search_threads - 1 helpers as find a free search slot
+* search alongside through the shared table.
+* Anything but the book or a forced move waits for a search slot. Once
+* search_slice_ms is up it stops at the next budget check that finds
+* another search waiting, queues again and resumes one ply past the
+* deepest iteration finished, where the table makes the replay cheap.
+* return best move found by this thread
+*/
+int searchBestMove(struct reversi_search * search, const struct reversi_board * board, int player,
+		struct search_ticket * ticket) {
+	struct search_helper * h;
+	u64 moves, helpers, rest;
+	int move, empties, stopAll;
+	unsigned int i, threads;
+
+	/*book replies cost no search*/
+	move = probeBook(board, player);
+	if (move >= 0) {
+		search->bestMove = move;
+		return move;
+	}
+
+	moves = tallyLegalMoves(player, board);
+	search->bestMove = __ffs64(moves);
+	if (!(moves & (moves - 1))) {
+		/*only one move, nothing to search*/
+		return search->bestMove;
+	}
+
+	if (ticket->ponder) {
+		if (!tryGetSearchSlot()) {
+			ticket->preempted = 1;
+			return search->bestMove;
+		}
+	} else {
+		getSearchSlot(ticket);
+	}
+
+	empties = BOARDSIZE - hweight64(board->discs[PLAYER_BLACK] | board->discs[PLAYER_WHITE]);
+	if (empties <= min(READ_ONCE(endgame_empties), (unsigned int)ENDGAME_EMPTIES_MAX)) {
+		/*exact solves at this size are quick, never sliced*/
+		solveBestMove(search, board, player);
+		putSearchSlot();
+		return search->bestMove;
+	}
+
+	threads = clamp(READ_ONCE(search_threads), 1U, min(num_online_cpus(), (unsigned int)SEARCH_THREADS_MAX));
+	for (;;) {
+		/*slices only end early while another search waits for a slot, ponder gives way at once*/
+		if (ticket->ponder || READ_ONCE(search_slice_ms)) {
+			search->waiting = &sched.queuedAll;
+			search->sliceEnd = ktime_add_ms(ktime_get(), ticket->ponder ? 0 : READ_ONCE(search_slice_ms));
+		}
+
+		/*taken afresh each slice, a slice that yields gives them up too*/
+		helpers = threads > 1 ? getHelpers(threads - 1) : 0;
+		stopAll = 0;
+		for (rest = helpers, i = 0; rest; rest &= rest - 1, i++) {
+			h = &searchHelpers[__ffs64(rest)];
+			INIT_WORK(&h->work, searchHelperWork);
+			h->search = *search;
+			h->search.nodes = 0;
+			h->search.stopAll = &stopAll;
+			h->search.waiting = NULL;
+			h->board = *board;
+			h->player = player;
+			/*every other helper runs a ply ahead so the threads spread over depths*/
+			h->firstDepth = search->depth + 1 + (i & 1);
+			queue_work(search_wq, &h->work);
+		}
+
+		deepenSearch(search, board, player, search->depth + 1);
+
+		WRITE_ONCE(stopAll, 1);
+		for (rest = helpers; rest; rest &= rest - 1) {
+			h = &searchHelpers[__ffs64(rest)];
+			flush_work(&h->work);
+			search->nodes += h->search.nodes;
+		}
+		putHelpers(helpers);
+
+		/*a budget spent before the yield, or by the helper nodes just counted, ends the search*/
+		if (!search->yielded || searchBudgetSpent(search)) {
+			break;
+		}
+		search->yielded = 0;
+		search->stopped = 0;
+		if (!yieldSearchSlot(ticket)) {
+			search->stopped = 1;
+			break;
+		}
+	}
+	search->waiting = NULL;
+	putSearchSlot();
+	return search->bestMove;
+}
+
+/*
+*  open, release, read, and write
+*/
+static int reversi_open(struct inode *inode, struct file *f)
+{
+	struct reversi_data * node = container_of(inode->i_cdev, struct reversi_data, reversi_cdev);
+	struct reversi_session * s;
+
+	/*every open gets its own game*/
+	s = allocSession(node);
+	if (s == NULL)
+	{
+		pr_debug("open() could not allocate a session\n");
+		return -ENOMEM;
+	}
+	s->shared = (struct reversi_mmap_board *)get_zeroed_page(GFP_KERNEL_ACCOUNT);
+	if (s->shared == NULL)
+	{
+		this_cpu_inc(node->stats->allocFailures);
+		freeSession(s);
+		return -ENOMEM;
+	}
+	publishBoard(s);
+
+	spin_lock(&node->lock);
+	list_add(&s->node_entry, &node->sessions);
+	spin_unlock(&node->lock);
+	atomic_inc(&node->activeSessions);
+	atomic_long_inc(&node->opens);
+
+	f->private_data = s;
+	trace_reversi_session_open(s, MINOR(node->reversi_cdev.dev), atomic_read(&node->activeSessions));
+	pr_debug("open()\n");
+    return 0;
+}
+static int reversi_release(struct inode *inode, struct file *f)
+{
+	struct reversi_session * s = f->private_data;
+
+	spin_lock(&s->node->lock);
+	list_del(&s->node_entry);
+	spin_unlock(&s->node->lock);
+	atomic_dec(&s->node->activeSessions);
+	trace_reversi_session_release(s, MINOR(s->node->reversi_cdev.dev), atomic_read(&s->node->activeSessions));
+
+	freeSession(s);
+	pr_debug("close()\n");
+    return 0;
+}
+
+/*
+* take in node,
+* allocate a session with no game dealt, charged to the caller
+* return the session, or NULL
+*/
+static struct reversi_session * allocSession(struct reversi_data * node)
+{
+	struct reversi_session * s;
+
+	s = kmem_cache_zalloc(session_cache, GFP_KERNEL_ACCOUNT);
+	if (s == NULL) {
+		this_cpu_inc(node->stats->allocFailures);
+		return NULL;
+	}
+	this_cpu_inc(node->stats->sessionAllocs);
+
+	/*Set up session*/
+	mutex_init(&s->lock);
+	INIT_WORK(&s->moveWork, computerMoveWork);
+	INIT_WORK(&s->perftWork, perftWork);
+	INIT_WORK(&s->ponderWork, ponderWork);
+	init_waitqueue_head(&s->readq);
+	xa_init_flags(&s->games, XA_FLAGS_ALLOC1);
+	kref_init(&s->ref);
+	s->inGame = 0;
+	s->humanToken = PLAYER_BLACK;
+	s->computerToken = PLAYER_WHITE;
+    s->prevPlayer = PLAYER_WHITE;
+    s->score = 0;
+	s->qos = REVERSI_QOS_NORMAL;
+	s->node = node;
+	return s;
+}
+
+static void freeSessionRcu(struct rcu_head *rcu)
+{
+	kmem_cache_free(session_cache, container_of(rcu, struct reversi_session, rcu));
+}
+
+/*
+* take in a session nothing else uses any more,
+* free it along with every game it created
+*/
+static void freeSession(struct reversi_session * s)
+{
+	struct reversi_session * game;
+	unsigned long id;
+
+	/*no ioctl runs on a closed file, so each game's only reference is its entry*/
+	xa_for_each(&s->games, id, game) {
+		xa_erase(&s->games, id);
+		kref_put(&game->ref, releaseGame);
+	}
+	xa_destroy(&s->games);
+
+	/*let a search or count still in flight finish before its session goes*/
+	cancel_work_sync(&s->moveWork);
+	cancel_work_sync(&s->perftWork);
+	WRITE_ONCE(s->ponderStop, 1);
+	cancel_work_sync(&s->ponderWork);
+	if (s->view != NULL) {
+		/*no new spectators, those already watching read the last board then EOF*/
+		xa_erase(&s->node->views, s->view->id);
+		WRITE_ONCE(s->view->closed, 1);
+		wake_up_interruptible_all(&s->view->wait);
+		kref_put(&s->view->ref, releaseView);
+	}
+	if (s->watching != NULL) {
+		atomic_dec(&s->node->spectators);
+		kref_put(&s->watching->ref, releaseView);
+	}
+	mutex_destroy(&s->lock);
+	/*a mapping still alive holds its own reference to the page*/
+	free_page((unsigned long)s->shared);
+	this_cpu_inc(s->node->stats->sessionFrees);
+	call_rcu(&s->rcu, freeSessionRcu);
+}
+
+static void releaseGame(struct kref *ref)
+{
+	freeSession(container_of(ref, struct reversi_session, ref));
+}
+
+/*
+* take in session and whether the caller opened it O_NONBLOCK,
+* wait until no computer move or perft is in flight and take the session lock.
+* return 0 with the lock held, or a negative error without it
+*/
+static int lockIdleSession(struct reversi_session * s, int nonblock)
+{
+	for (;;) {
+		if (mutex_lock_interruptible(&s->lock)) {
+			return -ERESTARTSYS;
+		}
+		if (!s->busy) {
+			return 0;
+		}
+		mutex_unlock(&s->lock);
+		if (nonblock) {
+			return -EAGAIN;
+		}
+		if (wait_event_interruptible(s->readq, !READ_ONCE(s->busy))) {
+			return -ERESTARTSYS;
+		}
+	}
+}
+
+/*
+* take in the last reference to a view,
+* free it once lookups that may still see it in node->views are done
+*/
+static void releaseView(struct kref *ref)
+{
+	struct reversi_view * v = container_of(ref, struct reversi_view, ref);
+
+	kfree_rcu(v, rcu);
+}
+
+/*
+* take in view and ioctl argument, no lock needed.
+* copy out a consistent board, retrying while the player rewrites it
+* return the version copied
+*/
+static u32 readView(struct reversi_view * v, struct reversi_ioc_game * game)
+{
+	unsigned int seq;
+	u32 version;
+
+	do {
+		seq = read_seqbegin(&v->lock);
+		game->black = v->black;
+		game->white = v->white;
+		game->human = v->human;
+		game->nextPlayer = v->nextPlayer;
+		game->result = v->inGame ? REVERSI_OK : REVERSI_NOGAME;
+		version = v->version;
+	} while (read_seqretry(&v->lock, seq));
+	return version;
+}
+
+/*
+* read() of a spectator, never touching the player's session.
+* Each read returns the whole board, as "01" would show it, once per
+* version. A decided game's final board stays readable until the
+* player closes, then EOF.
+*/
+static ssize_t watchRead(struct file *f, struct reversi_session * s, char __user *buf, size_t len)
+{
+	struct reversi_view * v = s->watching;
+	struct reversi_ioc_game game;
+	struct reversi_board board;
+	char out[BOARD_LEN + 1];
+	u32 version, seen;
+	size_t outLen;
+
+	if (len < BOARD_LEN) {
+		return -EINVAL;
+	}
+	for (;;) {
+		seen = READ_ONCE(s->seen);
+		version = readView(v, &game);
+		if (version != seen) {
+			break;
+		}
+		if (READ_ONCE(v->closed)) {
+			return 0;
+		}
+		if (f->f_flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		if (wait_event_interruptible(v->wait, READ_ONCE(v->version) != seen || READ_ONCE(v->closed))) {
+			return -ERESTARTSYS;
+		}
+	}
+	if ((game.black | game.white) == 0) {
+		/*nothing dealt yet*/
+		strcpy(out, NOGAME);
+	} else {
+		board.discs[PLAYER_BLACK] = game.black;
+		board.discs[PLAYER_WHITE] = game.white;
+		renderBoard(&board, game.nextPlayer == REVERSI_NONE ? game.human : game.nextPlayer, out);
+	}
+	outLen = strlen(out);
+	if (copy_to_user(buf, out, outLen)) {
+		return -EFAULT;
+	}
+	WRITE_ONCE(s->seen, version);
+	return outLen;
+}
+
+static ssize_t reversi_read(struct file *f, char __user *buf, size_t len, loff_t *off)
+{
+	struct reversi_session * s = f->private_data;
+	ssize_t ret;
+
+	if (smp_load_acquire(&s->watching) != NULL) {
+		return watchRead(f, s, buf, len);
+	}
+
+	/*results of a batch come back together, after any computer move in it*/
+	ret = lockIdleSession(s, f->f_flags & O_NONBLOCK);
+	if (ret) {
+		return ret;
+	}
+	if (s->responseLen == 0 && (f->f_flags & O_NONBLOCK)) {
+		mutex_unlock(&s->lock);
+		return -EAGAIN;
+	}
+    /*hand back queued responses, never more than are queued*/
+    len = min(len, s->responseLen);
+    if( copy_to_user(buf, s->response, len) == 0){
+        pr_debug("read() %zd bytes\n", len);
+        /*keep whatever did not fit for the next read*/
+        s->responseLen -= len;
+        memmove(s->response, s->response + len, s->responseLen);
+        ret = len;
+        /*commands held back for want of response room can run now*/
+        runPendingCommands(s);
+    } else {
+        pr_debug("bad copy to user in read()\n");
+        ret = -EFAULT;
+    }
+	mutex_unlock(&s->lock);
+	wake_up_interruptible(&s->readq);
+	return ret;
+}
+/*
+* take in session, a blocked writer checks it without the session lock.
+* return bytes input can still take, never more than INPUT_MAX
+*/
+static size_t inputRoom(const struct reversi_session * s)
+{
+	size_t used = READ_ONCE(s->inputLen);
+
+	return used < INPUT_MAX ? INPUT_MAX - used : 0;
+}
+
+/*
+* take in session, user buffer and its length, called with session lock held.
+* copy as many whole commands as fit behind those already waiting in input
+* return bytes taken, 0 when input is too full for the next command,
+* or a negative error
+*/
+static ssize_t appendInput(struct reversi_session * s, const char __user *cmd, size_t len)
+{
+	size_t take;
+	char * start = s->input + s->inputLen;
+
+	if (inputRoom(s) == 0) {
+		return 0;
+	}
+	take = min(len, inputRoom(s));
+	if (copy_from_user(start, cmd, take) != 0) {
+		/*unable to copy command*/
+		pr_debug("bad copy from user in write()\n");
+		return -EFAULT;
+	}
+	/*last command of the write may skip its newline if input has a byte left for it*/
+	if (take == len && (start[take - 1] == '\n' || s->inputLen + take < INPUT_MAX)) {
+		if (start[take - 1] != '\n') {
+			start[take] = '\n';
+			s->inputLen++;
+		}
+		s->inputLen += take;
+		return take;
+	}
+	/*cut back to the last whole command that fit, the rest is written again*/
+	while (take > 0 && start[take - 1] != '\n') {
+		take--;
+	}
+	if (take == 0 && s->inputLen == 0) {
+		/*longer than input can ever hold, so longer than any valid command*/
+		return -EINVAL;
+	}
+	s->inputLen += take;
+	return take;
+}
+
+static ssize_t reversi_write(struct file *f, const char __user *cmd, size_t len, loff_t *off)
+{
+	struct reversi_session * s = f->private_data;
+	size_t room;
+	ssize_t ret;
+	pr_debug("write() %zu bytes\n", len);
+
+	if (len == 0) {
+		return 0;
+	}
+	for (;;) {
+		/*one batch at a time per game, other sessions run untouched*/
+		if (mutex_lock_interruptible(&s->lock))
+		{
+			return -ERESTARTSYS;
+		}
+		ret = appendInput(s, cmd, len);
+		if (ret > 0) {
+			runPendingCommands(s);
+		}
+		if (ret == 0) {
+			/*the next line needs more room than this*/
+			room = inputRoom(s);
+		}
+		mutex_unlock(&s->lock);
+		if (ret != 0) {
+			break;
+		}
+		/*no room for the next line behind a computer move or unread responses*/
+		if (f->f_flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		if (wait_event_interruptible(s->readq, inputRoom(s) > room)) {
+			return -ERESTARTSYS;
+		}
+	}
+	/*responses of commands that ran right away are ready for pollers*/
+	wake_up_interruptible(&s->readq);
+	return ret;
+}
+
+/*
+* readable once no computer move or perft is in flight and responses are queued,
+* writable while input has room for the longest valid command
+*/
+static __poll_t reversi_poll(struct file *f, poll_table *wait)
+{
+	struct reversi_session * s = f->private_data;
+	struct reversi_view * v = smp_load_acquire(&s->watching);
+	__poll_t mask = 0;
+
+	if (v != NULL) {
+		/*spectators wake on every new board and hang up with the player*/
+		poll_wait(f, &v->wait, wait);
+		if (READ_ONCE(v->version) != READ_ONCE(s->seen)) {
+			mask |= EPOLLIN | EPOLLRDNORM;
+		}
+		if (READ_ONCE(v->closed)) {
+			mask |= EPOLLHUP;
+		}
+		return mask;
+	}
+	poll_wait(f, &s->readq, wait);
+	mutex_lock(&s->lock);
+	if (!s->busy && s->responseLen > 0) {
+		mask |= EPOLLIN | EPOLLRDNORM;
+	}
+	if (inputRoom(s) >= CMD_MAX) {
+		mask |= EPOLLOUT | EPOLLWRNORM;
+	}
+	mutex_unlock(&s->lock);
+	return mask;
+}
+
+/*
+* map the session's board page, see struct reversi_mmap_board.
+* One page at offset 0, never writable.
+*/
+static int reversi_mmap(struct file *f, struct vm_area_struct *vma)
+{
+	struct reversi_session * s = f->private_data;
+
+	if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE) {
+		return -EINVAL;
+	}
+	if (vma->vm_flags & VM_WRITE) {
+		return -EPERM;
+	}
+	/*no mprotect to writable later, no mremap past the one page*/
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	return vm_insert_page(vma, vma->vm_start, virt_to_page(s->shared));
+}
+
+/*
+* take in session, called with session lock held.
+* run newline separated commands from input in order, queueing one
+* response each, until input is empty, a computer move or perft goes
+* to the workqueue, or the next response might not fit before a read
+*/
+static void runPendingCommands(struct reversi_session * s)
+{
+	size_t lineLen;
+	char * end;
+	int kind;
+	u64 start;
+	/*commands are short, copy one at a time onto the stack plus room for a terminator*/
+	char the_cmd[CMD_MAX];
+
+	while (s->inputLen > 0 && !s->busy && RESP_MAX - s->responseLen >= BOARD_LEN) {
+		/*appendInput ends every command in input with a newline*/
+		end = memchr(s->input, '\n', s->inputLen);
+		lineLen = end - s->input + 1;
+		if (lineLen > CMD_MAX) {
+			/*longer than any valid command*/
+			queueResponse(s, INVFMT);
+			recordCommand(s->node, STAT_ERROR, 0);
+			atomic_long_inc(&s->node->commands);
+		} else if (lineLen > 1) {
+			/*blank lines get no response, the newline is not copied*/
+			memcpy(the_cmd, s->input, lineLen - 1);
+			the_cmd[lineLen - 1] = '\0';
+			start = ktime_get_ns();
+			kind = reversi_command(s, the_cmd);
+			publishBoard(s);
+			/*a queued computer move or perft is recorded when it finishes*/
+			if (!s->busy) {
+				recordCommand(s->node, kind, ktime_get_ns() - start);
+			}
+			atomic_long_inc(&s->node->commands);
+		}
+		s->inputLen -= lineLen;
+		memmove(s->input, s->input + lineLen, s->inputLen);
+	}
+}
+
+/*
+* take in session and a response string, called with session lock held.
+* append the response for the next read, the writer checked there is room
+*/
+static void queueResponse(struct reversi_session * s, const char * response)
+{
+	size_t len = strlen(response);
+
+	memcpy(s->response + s->responseLen, response, len);
+	s->responseLen += len;
+}
+
+/*
+* take in view and the game state just published, called with session lock held.
+* pass a changed board on to spectators, the only writer of the view
+*/
+static void publishView(struct reversi_view * v, const struct reversi_ioc_game * game, int inGame)
+{
+	/*"01" and the like change nothing, so spectators are not woken for them*/
+	if (v->black == game->black && v->white == game->white && v->inGame == inGame &&
+			v->nextPlayer == game->nextPlayer && v->human == game->human) {
+		return;
+	}
+	write_seqlock(&v->lock);
+	v->black = game->black;
+	v->white = game->white;
+	v->inGame = inGame;
+	v->human = game->human;
+	v->nextPlayer = game->nextPlayer;
+	WRITE_ONCE(v->version, v->version + 1);
+	write_sequnlock(&v->lock);
+	if (wq_has_sleeper(&v->wait)) {
+		wake_up_interruptible(&v->wait);
+	}
+}
+
+/*
+* take in session, called with session lock held or before it is shared.
+* rewrite the mapped board page, seq odd for the duration,
+* and the spectators' view when the game is shared
+*/
+static void publishBoard(struct reversi_session * s)
+{
+	struct reversi_mmap_board * b = s->shared;
+	struct reversi_ioc_game game;
+
+	if (b == NULL && s->view == NULL) {
+		return;
+	}
+	fillGameState(s, &game);
+	if (b != NULL) {
+		WRITE_ONCE(b->seq, b->seq + 1);
+		smp_wmb();
+		WRITE_ONCE(b->inGame, s->inGame);
+		WRITE_ONCE(b->human, game.human);
+		WRITE_ONCE(b->nextPlayer, game.nextPlayer);
+		WRITE_ONCE(b->black, game.black);
+		WRITE_ONCE(b->white, game.white);
+		WRITE_ONCE(b->blackCount, countToken(PLAYER_BLACK, &s->the_board));
+		WRITE_ONCE(b->whiteCount, countToken(PLAYER_WHITE, &s->the_board));
+		smp_wmb();
+		WRITE_ONCE(b->seq, b->seq + 1);
+	}
+	if (s->view != NULL) {
+		publishView(s->view, &game, s->inGame);
+	}
+}
+
+/*
+* take in node, STAT_* kind and how long the command took,
+* count it and drop it into its log2 latency bucket
+*/
+static void recordCommand(struct reversi_data * node, int kind, u64 ns)
+{
+	int bucket = ns ? min(ilog2(ns), LATENCY_BUCKETS - 1) : 0;
+
+	this_cpu_inc(node->stats->commands[kind]);
+	this_cpu_inc(node->stats->latency[kind][bucket]);
+}
+
+/*
+* take in node, a finished search and how long it ran,
+* add its nodes and time to the totals behind nodes per second
+*/
+static void recordSearch(struct reversi_data * node, const struct reversi_search * search, u64 ns)
+{
+	this_cpu_inc(node->stats->searches);
+	this_cpu_add(node->stats->searchNodes, search->nodes);
+	this_cpu_add(node->stats->searchNs, ns);
+}
+
+/*
+* game actions, shared by the text commands and the ioctls.
+* All take the session with its lock held and return a REVERSI_* result.
+*/
+
+/* text response for each REVERSI_* result */
+static const char * const RESULT_STRINGS[] = {
+	[REVERSI_OK] = OK,
+	[REVERSI_WIN] = WIN,
+	[REVERSI_TIE] = TIE,
+	[REVERSI_LOSE] = LOSE,
+	[REVERSI_NOGAME] = NOGAME,
+	[REVERSI_ILLMOVE] = ILLMOVE,
+	[REVERSI_OOT] = OOT,
+};
+
+/*
+* take in session and the colour the human plays,
+* deal a fresh board. Black moves first, so pretend white moved last.
+*/
+static int newGame(struct reversi_session * s, int human)
+{
+	/*answers pondered for the last game may be for the other colour*/
+	WRITE_ONCE(s->ponderStop, 1);
+	s->ponderLen = 0;
+	setupBoard(&s->the_board);
+	s->inGame = 1;
+	s->humanToken = human;
+	s->computerToken = OPPONENT(human);
+	s->prevPlayer = PLAYER_WHITE;
+	atomic_long_inc(&s->node->games);
+	return REVERSI_OK;
+}
+
+/*
+* take in session once neither side can move,
+* always tally with respect to human perspective
+*/
+static int endGame(struct reversi_session * s)
+{
+	int result;
+
+	s->score = figureWhoWon(s->humanToken, &s->the_board);
+	s->inGame = 0;
+	if (s->score > 0) {
+		result = REVERSI_WIN;
+	} else if (s->score == 0) {
+		result = REVERSI_TIE;
+	} else {
+		result = REVERSI_LOSE;
+	}
+	trace_reversi_game_end(s, result, countToken(s->humanToken, &s->the_board),
+		countToken(s->computerToken, &s->the_board));
+	return result;
+}
+
+/*
+* take in session and the human's column and row,
+* play the move when it is the human's turn and the move is legal
+*/
+static int humanMove(struct reversi_session * s, int col, int row)
+{
+	int nextPlayer, move, legal;
+
+	if (!s->inGame) {
+		return REVERSI_NOGAME;
+	}
+	/* check for user turn*/
+	nextPlayer = checkNextPlayer(&s->the_board, s->prevPlayer);
+	if (nextPlayer == NO_PLAYER) {
+		return endGame(s);
+	}
+	if (nextPlayer != s->humanToken) {
+		return REVERSI_OOT;
+	}
+	/*anything off the board is illegal*/
+	move = (col >= 0 && col < BOARD_DIM && row >= 0 && row < BOARD_DIM) ? SQUARE(col, row) : -1;
+	legal = checkForLegal(move, s->humanToken, &s->the_board);
+	trace_reversi_human_move(s, col, row, legal);
+	if (!legal) {
+		return REVERSI_ILLMOVE;
+	}
+	/*whatever it was pondering, the computer's answer is kept if already found*/
+	WRITE_ONCE(s->ponderStop, 1);
+	s->prevPlayer = s->humanToken;
+	makeYourMove(move, s->prevPlayer, &s->the_board);
+	return REVERSI_OK;
+}
+
+/*
+* take in session,
+* return REVERSI_OK when the computer is to move, else the result to report
+*/
+static int computerTurn(struct reversi_session * s)
+{
+	int nextPlayer;
+
+	if (!s->inGame) {
+		return REVERSI_NOGAME;
+	}
+	/* checkNextPlayer guarantees that nextPlayer has a legal move available*/
+	nextPlayer = checkNextPlayer(&s->the_board, s->prevPlayer);
+	if (nextPlayer == NO_PLAYER) {
+		return endGame(s);
+	}
+	if (nextPlayer != s->computerToken) {
+		return REVERSI_OOT;
+	}
+	return REVERSI_OK;
+}
+
+/*
+* take in the node budget the search will get,
+* return its time budget in ms, the default while neither is set
+* so no search runs unbounded
+*/
+static unsigned int searchTimeMs(unsigned long nodes)
+{
+	unsigned int ms = READ_ONCE(search_time_ms);
+
+	return ms != 0 || nodes != 0 ? ms : SEARCH_TIME_DEFAULT_MS;
+}
+
+/*
+* take in session, the board to search and the player to move,
+* search it within the per move budget, counting and tracing the search.
+* return the move to play
+*/
+static int runSearch(struct reversi_session * s, const struct reversi_board * board, int player)
+{
+	struct reversi_search search;
+	struct search_ticket ticket = { .qos = READ_ONCE(s->qos) };
+	unsigned long nodes;
+	int move;
+	u64 start, ns;
+
+	trace_reversi_search_start(s, player, BOARDSIZE - board->count[PLAYER_BLACK] - board->count[PLAYER_WHITE]);
+	start = ktime_get_ns();
+	/*the budget starts now, time spent waiting for a slot comes out of it*/
+	nodes = READ_ONCE(search_nodes);
+	initSearch(&search, searchTimeMs(nodes), nodes, READ_ONCE(search_depth));
+	ticket.deadline = search.useDeadline ? search.deadline : KTIME_MAX;
+	move = searchBestMove(&search, board, player, &ticket);
+	ns = ktime_get_ns() - start;
+	recordSearch(s->node, &search, ns);
+	trace_reversi_search_end(s, move, search.depth, search.nodes, search.score, ns);
+	return move;
+}
+
+/*
+* take in session and where to report the square played,
+* search and play the computer's move when it is the computer's turn
+*/
+static int computerMove(struct reversi_session * s, int * movePlayed)
+{
+	int result, move;
+
+	result = computerTurn(s);
+	if (result != REVERSI_OK) {
+		return result;
+	}
+	/* Computer searches its legal moves within the per move budget. */
+	move = ponderHit(s);
+	if (move < 0) {
+		move = runSearch(s, &s->the_board, s->computerToken);
+	}
+	s->prevPlayer = s->computerToken;
+	makeYourMove(move, s->prevPlayer, &s->the_board);
+	startPonder(s);
+	*movePlayed = move;
+	return REVERSI_OK;
+}
+
+/*
+* take in session, called with session lock held on the computer's turn.
+* return the move pondered for this position, or -1 to search it now
+*/
+static int ponderHit(struct reversi_session * s)
+{
+	int i;
+
+	for (i = 0; i < s->ponderLen; i++) {
+		if (s->ponder[i].discs[PLAYER_BLACK] == s->the_board.discs[PLAYER_BLACK] &&
+				s->ponder[i].discs[PLAYER_WHITE] == s->the_board.discs[PLAYER_WHITE]) {
+			this_cpu_inc(s->node->stats->ponderHits);
+			return s->ponder[i].move;
+		}
+	}
+	return -1;
+}
+
+/*
+* take in session, called with session lock held after the computer moves.
+* ponder the human's replies when pondering is on and the human is to move
+*/
+static void startPonder(struct reversi_session * s)
+{
+	if (READ_ONCE(ponder) && s->inGame && checkNextPlayer(&s->the_board, s->prevPlayer) == s->humanToken) {
+		queue_work(reversi_wq, &s->ponderWork);
+	}
+}
+
+/*
+* workqueue side of pondering. Ranks the human's replies by the static
+* evaluation and, likeliest first, searches the computer's answer to
+* each within the per move budget, so a hit plays what a search on the
+* computer's turn would have. Stops early once the human moves or a
+* search waits for its slot; the transposition table keeps what was
+* searched either way.
+*/
+static void ponderWork(struct work_struct *work)
+{
+	struct reversi_session * s = container_of(work, struct reversi_session, ponderWork);
+	struct reversi_board board, child;
+	struct reversi_search search;
+	struct search_ticket ticket = { .deadline = KTIME_MAX, .qos = REVERSI_QOS_BULK, .ponder = 1 };
+	int replies[PONDER_REPLIES], scores[PONDER_REPLIES];
+	unsigned long nodes;
+	int human, move, score, n, i;
+	u64 moves;
+
+	mutex_lock(&s->lock);
+	/*a run this one was queued behind has stopped by now*/
+	WRITE_ONCE(s->ponderStop, 0);
+	s->ponderLen = 0;
+	if (!s->inGame || checkNextPlayer(&s->the_board, s->prevPlayer) != s->humanToken) {
+		mutex_unlock(&s->lock);
+		return;
+	}
+	board = s->the_board;
+	human = s->humanToken;
+	mutex_unlock(&s->lock);
+
+	/*keep the PONDER_REPLIES best for the human, best first*/
+	n = 0;
+	for (moves = tallyLegalMoves(human, &board); moves; moves &= moves - 1) {
+		move = __ffs64(moves);
+		child = board;
+		makeYourMove(move, human, &child);
+		score = evaluateBoard(human, &child);
+		if (n == PONDER_REPLIES && score <= scores[n - 1]) {
+			continue;
+		}
+		if (n < PONDER_REPLIES) {
+			n++;
+		}
+		for (i = n - 1; i > 0 && scores[i - 1] < score; i--) {
+			scores[i] = scores[i - 1];
+			replies[i] = replies[i - 1];
+		}
+		scores[i] = score;
+		replies[i] = move;
+	}
+
+	for (i = 0; i < n && !READ_ONCE(s->ponderStop); i++) {
+		child = board;
+		makeYourMove(replies[i], human, &child);
+		if (!tallyLegalMoves(OPPONENT(human), &child)) {
+			/*computer would have to pass, nothing to answer*/
+			continue;
+		}
+		nodes = READ_ONCE(search_nodes);
+		initSearch(&search, searchTimeMs(nodes), nodes, READ_ONCE(search_depth));
+		search.stopAll = &s->ponderStop;
+		move = searchBestMove(&search, &child, OPPONENT(human), &ticket);
+		if (ticket.preempted) {
+			/*pondering only ever takes idle slots, searches waiting come first*/
+			break;
+		}
+		this_cpu_inc(s->node->stats->ponderSearches);
+
+		mutex_lock(&s->lock);
+		/*cut short, so not the answer a full search would give*/
+		if (!READ_ONCE(s->ponderStop)) {
+			s->ponder[s->ponderLen].discs[PLAYER_BLACK] = child.discs[PLAYER_BLACK];
+			s->ponder[s->ponderLen].discs[PLAYER_WHITE] = child.discs[PLAYER_WHITE];
+			s->ponder[s->ponderLen].move = move;
+			s->ponderLen++;
+		}
+		mutex_unlock(&s->lock);
+	}
+}
+
+/*
+* take in session,
+* hand the computer's move to the workqueue when it is the computer's turn.
+* return MOVE_PENDING once queued, computerMoveWork reports the result
+*/
+static int startComputerMove(struct reversi_session * s)
+{
+	int result;
+
+	result = computerTurn(s);
+	if (result != REVERSI_OK) {
+		return result;
+	}
+	s->busy = 1;
+	s->moveQueued = ktime_get_ns();
+	queue_work(reversi_wq, &s->moveWork);
+	return MOVE_PENDING;
+}
+
+/*
+* workqueue side of "03". Searches a copy of the board without the
+* session lock, so reads, writes and polls never wait on the search,
+* then plays the move and runs whatever was written meanwhile.
+*/
+static void computerMoveWork(struct work_struct *work)
+{
+	struct reversi_session * s = container_of(work, struct reversi_session, moveWork);
+	struct reversi_board board;
+	int player, move;
+
+	/*nothing touches the board while busy, commands wait in input*/
+	mutex_lock(&s->lock);
+	board = s->the_board;
+	player = s->computerToken;
+	move = ponderHit(s);
+	mutex_unlock(&s->lock);
+
+	if (move < 0) {
+		move = runSearch(s, &board, player);
+	}
+
+	mutex_lock(&s->lock);
+	s->prevPlayer = player;
+	makeYourMove(move, player, &s->the_board);
+	startPonder(s);
+	publishBoard(s);
+	queueResponse(s, OK);
+	/*from the "03" being read to its response being ready*/
+	recordCommand(s->node, STAT_COMPUTER_MOVE, ktime_get_ns() - s->moveQueued);
+	s->busy = 0;
+	runPendingCommands(s);
+	mutex_unlock(&s->lock);
+	wake_up_interruptible(&s->readq);
+}
+
+/*
+* take in session,
+* human believes he has no moves left, pass when that is true
+*/
+static int humanPass(struct reversi_session * s)
+{
+	int nextPlayer;
+
+	if (!s->inGame) {
+		return REVERSI_NOGAME;
+	}
+	nextPlayer = checkNextPlayer(&s->the_board, s->prevPlayer);
+	if (nextPlayer == NO_PLAYER) {
+		return endGame(s);
+	}
+	if (nextPlayer == s->humanToken) {
+		/*human was wrong and still has a move left*/
+		return REVERSI_ILLMOVE;
+	}
+	/*computer moves next*/
+	WRITE_ONCE(s->ponderStop, 1);
+	s->prevPlayer = s->humanToken;
+	return REVERSI_OK;
+}
+
+/*
+* take in session and plies, called with session lock held.
+* hand "05" to the workqueue, which counts positions depth plies on from
+* the game in progress, or from the starting position when there is none
+*/
+static void startPerft(struct reversi_session * s, unsigned int depth)
+{
+	s->perftDepth = depth;
+	s->busy = 1;
+	s->moveQueued = ktime_get_ns();
+	queue_work(reversi_wq, &s->perftWork);
+}
+
+/*
+* workqueue side of "05". Counts in a search slot within the per move
+* time budget, like a search, on a copy of the board without the
+* session lock, then answers "<positions> <ns>\n", or TIMEOUT when the
+* budget ran out first, and runs whatever was written meanwhile.
+*/
+static void perftWork(struct work_struct *work)
+{
+	struct reversi_session * s = container_of(work, struct reversi_session, perftWork);
+	struct reversi_board board;
+	struct reversi_search search;
+	struct search_ticket ticket = { .qos = READ_ONCE(s->qos) };
+	char out[BOARD_LEN + 1];
+	int player;
+	u64 start, leaves;
+
+	/*nothing touches the board while busy, commands wait in input*/
+	mutex_lock(&s->lock);
+	if (s->inGame) {
+		board = s->the_board;
+		player = checkNextPlayer(&board, s->prevPlayer);
+		if (player == NO_PLAYER) {
+			/*finished, perft stops at once*/
+			player = s->humanToken;
+		}
+	} else {
+		setupBoard(&board);
+		player = PLAYER_BLACK;
+	}
+	mutex_unlock(&s->lock);
+
+	/*perft counts no nodes, so only the time budget bounds it*/
+	initSearch(&search, searchTimeMs(0), 0, 0);
+	ticket.deadline = search.useDeadline ? search.deadline : KTIME_MAX;
+	getSearchSlot(&ticket);
+	start = ktime_get_ns();
+	leaves = perft(&search, &board, player, s->perftDepth, 0);
+	putSearchSlot();
+	snprintf(out, sizeof(out), "%llu %llu\n", leaves, ktime_get_ns() - start);
+
+	mutex_lock(&s->lock);
+	queueResponse(s, search.stopped ? TIMEOUT : out);
+	/*from the "05" being read to its response being ready*/
+	recordCommand(s->node, STAT_PERFT, ktime_get_ns() - s->moveQueued);
+	s->busy = 0;
+	runPendingCommands(s);
+	mutex_unlock(&s->lock);
+	wake_up_interruptible(&s->readq);
+}
+
+/*
+* take in session and one command line, called with session lock held.
+* parse and run the command against the session's game,
+* queueing exactly one response, "03" and "05" from the workqueue.
+* return STAT_* kind of the command, for the stats
+*/
+static int reversi_command(struct reversi_session * s, char * the_cmd)
+{
+	int dam, col, row, result, kind;
+	unsigned int depth;
+	char term[] = "\0";
+	char * tokenArray[MAX_TOKENS];
+	char board[BOARD_LEN + 1];
+	const char * response;
+
+	trace_reversi_command(s, the_cmd);
+
+	/*Set aside appropriately sized token array */
+	dam = count_spaces(the_cmd); 
+	
+	/*too many arguments*/
+	if ( dam > 3 )
+	{
+		queueResponse(s, INVFMT);
+		return STAT_ERROR;
+	}
+
+	/*dam <= 3 means at most dam + 1 tokens plus the end marker, MAX_TOKENS slots*/
+	/*parse the_cmd*/
+	simpleParse(the_cmd, tokenArray);
+
+	/*interpret parsed command, match command and argument count together*/
+	if (!strcmp(tokenArray[0], COM00) && strcmp(tokenArray[1], term) && !strcmp(tokenArray[2], term))
+	{
+		/*human chooses black or white*/
+		kind = STAT_NEW_GAME;
+		if (!strcmp(tokenArray[1], BLACK)) {
+			response = RESULT_STRINGS[newGame(s, PLAYER_BLACK)];
+		} else if (!strcmp(tokenArray[1], WHITE)) {
+			response = RESULT_STRINGS[newGame(s, PLAYER_WHITE)];
+		} else {
+			response = INVFMT;
+			kind = STAT_ERROR;
+		}
+	}
+	else if (!strcmp(tokenArray[0], COM01) && !strcmp(tokenArray[1], term))
+	{
+		/*Returns the current state of the game board...*/
+		kind = STAT_GET_BOARD;
+		if (!s->inGame) {
+			response = NOGAME;
+		} else {
+			renderBoard(&s->the_board, checkNextPlayer(&s->the_board, s->prevPlayer) == s->computerToken ?
+				s->computerToken : s->humanToken, board);
+			response = board;
+		}
+	}
+	else if (!strcmp(tokenArray[0], COM02) && strcmp(tokenArray[1], term) && strcmp(tokenArray[2], term) &&
+			!strcmp(tokenArray[3], term))
+	{
+		/* good format of command */
+		kind = STAT_HUMAN_MOVE;
+		if (kstrtoint(tokenArray[1], 10, &col) == 0 && kstrtoint(tokenArray[2], 10, &row) == 0) {
+			response = RESULT_STRINGS[humanMove(s, col, row)];
+		} else {
+			response = INVFMT;
+			kind = STAT_ERROR;
+		}
+	}
+	else if (!strcmp(tokenArray[0], COM03) && !strcmp(tokenArray[1], term))
+	{
+		kind = STAT_COMPUTER_MOVE;
+		result = startComputerMove(s);
+		if (result == MOVE_PENDING) {
+			return kind;
+		}
+		response = RESULT_STRINGS[result];
+	}
+	else if (!strcmp(tokenArray[0], COM04) && !strcmp(tokenArray[1], term))
+	{
+		kind = STAT_PASS;
+		response = RESULT_STRINGS[humanPass(s)];
+	}
+	else if (!strcmp(tokenArray[0], COM05) && strcmp(tokenArray[1], term) && !strcmp(tokenArray[2], term))
+	{
+		/*move generator check and benchmark, see perft*/
+		kind = STAT_PERFT;
+		if (kstrtouint(tokenArray[1], 10, &depth) == 0 && depth <= PERFT_MAX_DEPTH) {
+			startPerft(s, depth);
+			return kind;
+		} else {
+			response = INVFMT;
+			kind = STAT_ERROR;
+		}
+	}
+	else if (!strcmp(tokenArray[0], COM00) || !strcmp(tokenArray[0], COM01) ||
+		 !strcmp(tokenArray[0], COM02) || !strcmp(tokenArray[0], COM03) ||
+		 !strcmp(tokenArray[0], COM04) || !strcmp(tokenArray[0], COM05))
+	{
+		/*known command with the wrong arguments for it*/
+		response = INVFMT;
+		kind = STAT_ERROR;
+	}
+	else
+	{
+		response = UNKCMD;
+		kind = STAT_ERROR;
+	}
+	queueResponse(s, response);
+	return kind;
+}
+
+/*
+* take in session and ioctl argument, called with session lock held.
+* copy out the board, colours and next player after a command
+*/
+static void fillGameState(struct reversi_session * s, struct reversi_ioc_game * game)
+{
+	int nextPlayer;
+
+	game->black = s->the_board.discs[PLAYER_BLACK];
+	game->white = s->the_board.discs[PLAYER_WHITE];
+	game->human = s->humanToken;
+	nextPlayer = s->inGame ? checkNextPlayer(&s->the_board, s->prevPlayer) : NO_PLAYER;
+	game->nextPlayer = (nextPlayer == NO_PLAYER) ? REVERSI_NONE : nextPlayer;
+}
+
+/*
+* take in session and where to put the ID,
+* share the session's game with spectators, the first call allocating its ID
+* return 0, or a negative error
+*/
+static long shareGame(struct reversi_session * s, u32 * id)
+{
+	struct reversi_ioc_game game;
+	struct reversi_view * v;
+	long ret = 0;
+
+	if (mutex_lock_interruptible(&s->lock)) {
+		return -ERESTARTSYS;
+	}
+	if (s->view == NULL) {
+		v = kzalloc(sizeof(*v), GFP_KERNEL_ACCOUNT);
+		if (v == NULL) {
+			mutex_unlock(&s->lock);
+			return -ENOMEM;
+		}
+		seqlock_init(&v->lock);
+		init_waitqueue_head(&v->wait);
+		kref_init(&v->ref);
+		/*start from the board as it stands, spectators' first read returns it*/
+		fillGameState(s, &game);
+		v->black = game.black;
+		v->white = game.white;
+		v->inGame = s->inGame;
+		v->human = game.human;
+		v->nextPlayer = game.nextPlayer;
+		v->version = 1;
+		ret = xa_alloc(&s->node->views, &v->id, v, xa_limit_31b, GFP_KERNEL_ACCOUNT);
+		if (ret) {
+			kfree(v);
+			mutex_unlock(&s->lock);
+			return ret;
+		}
+		s->view = v;
+	}
+	*id = s->view->id;
+	mutex_unlock(&s->lock);
+	return 0;
+}
+
+/*
+* take in file, session and ioctl argument,
+* make the session a spectator of the game with the ID at uid.
+* Only an fd opened read only can watch, and only once.
+* return 0, or a negative error
+*/
+static long watchGame(struct file *f, struct reversi_session * s, u32 __user *uid)
+{
+	struct reversi_view * v;
+	u32 id;
+	long ret = 0;
+
+	if (f->f_mode & FMODE_WRITE) {
+		return -EBADF;
+	}
+	if (get_user(id, uid)) {
+		return -EFAULT;
+	}
+	if (mutex_lock_interruptible(&s->lock)) {
+		return -ERESTARTSYS;
+	}
+	if (s->watching != NULL || s->view != NULL) {
+		ret = -EBUSY;
+		goto out;
+	}
+	rcu_read_lock();
+	v = xa_load(&s->node->views, id);
+	/*the player may be closing, its last reference already gone*/
+	if (v != NULL && !kref_get_unless_zero(&v->ref)) {
+		v = NULL;
+	}
+	rcu_read_unlock();
+	if (v == NULL) {
+		ret = -ENOENT;
+		goto out;
+	}
+	atomic_inc(&s->node->spectators);
+	smp_store_release(&s->watching, v);
+out:
+	mutex_unlock(&s->lock);
+	return ret;
+}
+
+/*
+* ioctls of a spectator, GET_BOARD from the view and nothing else
+*/
+static long watchIoctl(struct reversi_session * s, unsigned int cmd, void __user *uarg)
+{
+	struct reversi_ioc_game game;
+
+	if (cmd != REVERSI_IOC_GET_BOARD) {
+		return -EPERM;
+	}
+	memset(&game, 0, sizeof(game));
+	readView(s->watching, &game);
+	if (copy_to_user(uarg, &game, sizeof(game))) {
+		return -EFAULT;
+	}
+	return 0;
+}
+
+/*
+* take in session, ioctl command, its argument and whether the file is O_NONBLOCK.
+* Each runs the same game action as its text command and hands back
+* the result and board in one call, skipping the parser.
+* COMPUTER_MOVE searches in the caller, the call itself is the wait.
+* return 0 with game filled in, or a negative error
+*/
+static long gameIoctl(struct reversi_session * s, unsigned int cmd, struct reversi_ioc_game * game, int nonblock)
+{
+	long ret = 0;
+	int move, kind;
+	u64 start;
+
+	/*text "03" or "05" already in flight goes first*/
+	ret = lockIdleSession(s, nonblock);
+	if (ret) {
+		return ret;
+	}
+
+	start = ktime_get_ns();
+	kind = STAT_ERROR;
+	switch (cmd) {
+	case REVERSI_IOC_NEW_GAME:
+		if (game->human != REVERSI_BLACK && game->human != REVERSI_WHITE) {
+			ret = -EINVAL;
+			break;
+		}
+		kind = STAT_NEW_GAME;
+		game->result = newGame(s, game->human);
+		break;
+	case REVERSI_IOC_GET_BOARD:
+		kind = STAT_GET_BOARD;
+		game->result = s->inGame ? REVERSI_OK : REVERSI_NOGAME;
+		break;
+	case REVERSI_IOC_HUMAN_MOVE:
+		kind = STAT_HUMAN_MOVE;
+		game->result = humanMove(s, game->col, game->row);
+		break;
+	case REVERSI_IOC_COMPUTER_MOVE:
+		kind = STAT_COMPUTER_MOVE;
+		game->result = computerMove(s, &move);
+		if (game->result == REVERSI_OK) {
+			game->col = move % BOARD_DIM;
+			game->row = move / BOARD_DIM;
+		}
+		break;
+	case REVERSI_IOC_PASS:
+		kind = STAT_PASS;
+		game->result = humanPass(s);
+		break;
+	default:
+		ret = -ENOTTY;
+		break;
+	}
+	if (ret == 0) {
+		fillGameState(s, game);
+		publishBoard(s);
+	}
+	mutex_unlock(&s->lock);
+	recordCommand(s->node, kind, ktime_get_ns() - start);
+
+	if (ret == 0) {
+		atomic_long_inc(&s->node->commands);
+	}
+	return ret;
+}
+
+/*
+* take in session and ioctl argument,
+* add a game to the file, no game dealt yet
+* return 0 with its ID copied out, or a negative error
+*/
+static long createGame(struct reversi_session * s, u32 __user *uid)
+{
+	struct reversi_session * game;
+	u32 id;
+	int err;
+
+	if (atomic_inc_return(&s->nrGames) > READ_ONCE(max_games)) {
+		err = -ENOSPC;
+		goto undo;
+	}
+	game = allocSession(s->node);
+	if (game == NULL) {
+		err = -ENOMEM;
+		goto undo;
+	}
+	game->qos = READ_ONCE(s->qos);
+	err = xa_alloc(&s->games, &id, game, xa_limit_31b, GFP_KERNEL_ACCOUNT);
+	if (err) {
+		freeSession(game);
+		goto undo;
+	}
+	/*IDs are handed out lowest first, another thread may guess this one and destroy it*/
+	kref_get(&game->ref);
+	if (put_user(id, uid)) {
+		err = -EFAULT;
+		/*only undo what a destroy has not, the reference held keeps game from matching a new one*/
+		if (xa_cmpxchg(&s->games, id, game, NULL, 0) == game) {
+			atomic_dec(&s->nrGames);
+			kref_put(&game->ref, releaseGame);
+		}
+	}
+	kref_put(&game->ref, releaseGame);
+	return err;
+
+undo:
+	atomic_dec(&s->nrGames);
+	return err;
+}
+
+/*
+* take in session and ioctl argument,
+* remove the game with the ID at uid, freed once calls already using it return
+* return 0, or a negative error
+*/
+static long destroyGame(struct reversi_session * s, u32 __user *uid)
+{
+	struct reversi_session * game;
+	u32 id;
+
+	if (get_user(id, uid)) {
+		return -EFAULT;
+	}
+	game = xa_erase(&s->games, id);
+	if (game == NULL) {
+		return -ENOENT;
+	}
+	atomic_dec(&s->nrGames);
+	kref_put(&game->ref, releaseGame);
+	return 0;
+}
+
+/*
+* take in file, session and ioctl argument,
+* run one single game command on the game its ID names.
+* Lookups take no lock, so calls on different games of one file
+* only ever wait for each other on the same game.
+*/
+static long multiGameIoctl(struct file *f, struct reversi_session * s, struct reversi_ioc_multi __user *um)
+{
+	struct reversi_ioc_multi m;
+	struct reversi_session * game = s;
+	u32 viewId;
+	long ret;
+
+	if (copy_from_user(&m, um, sizeof(m))) {
+		return -EFAULT;
+	}
+	if (m.id != 0) {
+		rcu_read_lock();
+		game = xa_load(&s->games, m.id);
+		/*a destroy may have dropped the table's reference already*/
+		if (game != NULL && !kref_get_unless_zero(&game->ref)) {
+			game = NULL;
+		}
+		rcu_read_unlock();
+		if (game == NULL) {
+			return -ENOENT;
+		}
+	}
+	if (m.cmd == REVERSI_IOC_GAME_ID) {
+		ret = shareGame(game, &viewId);
+		m.game.result = viewId;
+	} else {
+		ret = gameIoctl(game, m.cmd, &m.game, f->f_flags & O_NONBLOCK);
+	}
+	if (game != s) {
+		kref_put(&game->ref, releaseGame);
+	}
+	if (ret == 0 && copy_to_user(um, &m, sizeof(m))) {
+		ret = -EFAULT;
+	}
+	return ret;
+}
+
+/*
+* take in session and ioctl argument,
+* move the session's searches to another REVERSI_QOS_* class.
+* Like nice, only CAP_SYS_NICE may go above normal.
+*/
+static long setQos(struct reversi_session * s, u32 __user *uqos)
+{
+	u32 qos;
+
+	if (get_user(qos, uqos)) {
+		return -EFAULT;
+	}
+	if (qos >= QOS_CLASSES) {
+		return -EINVAL;
+	}
+	if (qos < REVERSI_QOS_NORMAL && !capable(CAP_SYS_NICE)) {
+		return -EPERM;
+	}
+	WRITE_ONCE(s->qos, qos);
+	return 0;
+}
+
+/*
+* take in one position of a batch and the plies to search,
+* fill in its legal moves, score and best move
+* return 0, or -EINVAL when it is not a legal board
+*/
+static int evaluatePosition(struct reversi_ioc_position * pos, unsigned int depth)
+{
+	struct reversi_board board;
+	struct reversi_search search;
+	int player = pos->player;
+
+	if ((player != PLAYER_BLACK && player != PLAYER_WHITE) || (pos->black & pos->white)) {
+		return -EINVAL;
+	}
+	loadBoard(&board, pos->black, pos->white);
+	initSearch(&search, 0, 0, depth);
+	pos->moves = board.moves[player];
+	if (pos->moves) {
+		pos->bestMove = deepenSearch(&search, &board, player, 1);
+		pos->score = search.score;
+	} else {
+		/*negamax passes for player, or scores the final margin*/
+		pos->bestMove = REVERSI_NONE;
+		pos->score = negamax(&search, &board, player, depth, -SCORE_INF, SCORE_INF, 0);
+	}
+	return 0;
+}
+
+/*
+* take in session and ioctl argument,
+* evaluate the batch a page of positions at a time, each page copied in,
+* searched under one search slot and copied back out, so a batch costs
+* a few syscalls' worth of copies instead of one syscall per position.
+* Between positions it gives the slot up once its slice is over and
+* another search waits, like a search of a game would.
+* return 0, or a negative error with done saying how far it got
+*/
+static long evaluateBatch(struct reversi_session * s, struct reversi_ioc_batch __user *ub)
+{
+	struct reversi_ioc_batch batch;
+	struct reversi_ioc_position * chunk;
+	struct reversi_ioc_position __user * upos;
+	struct search_ticket ticket = { .qos = READ_ONCE(s->qos), .deadline = KTIME_MAX };
+	ktime_t sliceEnd;
+	u32 n, i;
+	u64 start;
+	long ret = 0;
+
+	if (copy_from_user(&batch, ub, sizeof(batch))) {
+		return -EFAULT;
+	}
+	if (batch.depth < 1 || batch.depth > REVERSI_EVAL_MAX_DEPTH) {
+		return -EINVAL;
+	}
+	chunk = kmalloc(EVAL_CHUNK * sizeof(*chunk), GFP_KERNEL_ACCOUNT);
+	if (chunk == NULL) {
+		return -ENOMEM;
+	}
+	upos = u64_to_user_ptr(batch.positions);
+	start = ktime_get_ns();
+	batch.done = 0;
+	while (batch.done < batch.count) {
+		n = min_t(u32, batch.count - batch.done, EVAL_CHUNK);
+		if (copy_from_user(chunk, upos + batch.done, n * sizeof(*chunk))) {
+			ret = -EFAULT;
+			break;
+		}
+		getSearchSlot(&ticket);
+		sliceEnd = ktime_add_ms(ktime_get(), READ_ONCE(search_slice_ms));
+		for (i = 0; i < n; i++) {
+			/*a signal waits for one position at most, not a whole chunk*/
+			if (signal_pending(current)) {
+				ret = -EINTR;
+				break;
+			}
+			if (evaluatePosition(&chunk[i], batch.depth)) {
+				ret = -EINVAL;
+				break;
+			}
+			if (READ_ONCE(search_slice_ms) && READ_ONCE(sched.queuedAll) && ktime_after(ktime_get(), sliceEnd)) {
+				yieldSearchSlot(&ticket);
+				sliceEnd = ktime_add_ms(ktime_get(), READ_ONCE(search_slice_ms));
+			}
+		}
+		putSearchSlot();
+		if (copy_to_user(upos + batch.done, chunk, i * sizeof(*chunk))) {
+			ret = -EFAULT;
+			break;
+		}
+		batch.done += i;
+		if (ret) {
+			break;
+		}
+	}
+	kfree(chunk);
+	this_cpu_add(s->node->stats->evalPositions, batch.done);
+	recordCommand(s->node, STAT_EVALUATE, ktime_get_ns() - start);
+	if (put_user(batch.done, &ub->done) && ret == 0) {
+		ret = -EFAULT;
+	}
+	return ret;
+}
+
+/*
+* binary commands, see reversi_ioctl.h.
+* Single game commands run on the file's own game, REVERSI_IOC_GAME
+* runs them on any game the file created.
+*/
+static long reversi_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
+{
+	struct reversi_session * s = f->private_data;
+	struct reversi_ioc_game game;
+	void __user *uarg = (void __user *)arg;
+	u32 id;
+	long ret;
+
+	if (_IOC_TYPE(cmd) != REVERSI_IOC_MAGIC) {
+		return -ENOTTY;
+	}
+	if (smp_load_acquire(&s->watching) != NULL) {
+		return watchIoctl(s, cmd, uarg);
+	}
+	switch (cmd) {
+	case REVERSI_IOC_GAME_ID:
+		ret = shareGame(s, &id);
+		return ret ? ret : put_user(id, (u32 __user *)uarg);
+	case REVERSI_IOC_WATCH:
+		return watchGame(f, s, uarg);
+	case REVERSI_IOC_CREATE:
+		return createGame(s, uarg);
+	case REVERSI_IOC_DESTROY:
+		return destroyGame(s, uarg);
+	case REVERSI_IOC_GAME:
+		return multiGameIoctl(f, s, uarg);
+	case REVERSI_IOC_SET_QOS:
+		return setQos(s, uarg);
+	case REVERSI_IOC_EVALUATE:
+		return evaluateBatch(s, uarg);
+	}
+	if (copy_from_user(&game, uarg, sizeof(game))) {
+		return -EFAULT;
+	}
+	ret = gameIoctl(s, cmd, &game, f->f_flags & O_NONBLOCK);
+	if (ret) {
+		return ret;
+	}
+	if (copy_to_user(uarg, &game, sizeof(game))) {
+		return -EFAULT;
+	}
+	return 0;
+}
+
+/*
+* per node stats, read only, in /sys/class/reversiClass/reversiN/
+*/
+static ssize_t sessions_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%d\n", atomic_read(&node->activeSessions));
+}
+static DEVICE_ATTR_RO(sessions);
+
+static ssize_t spectators_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%d\n", atomic_read(&node->spectators));
+}
+static DEVICE_ATTR_RO(spectators);
+
+static ssize_t opens_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%ld\n", atomic_long_read(&node->opens));
+}
+static DEVICE_ATTR_RO(opens);
+
+static ssize_t commands_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%ld\n", atomic_long_read(&node->commands));
+}
+static DEVICE_ATTR_RO(commands);
+
+static ssize_t games_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%ld\n", atomic_long_read(&node->games));
+}
+static DEVICE_ATTR_RO(games);
+
+/*
+* take in node and offset of a u64 in struct reversi_stats,
+* return it summed over every CPU
+*/
+static u64 sumStat(struct reversi_data * node, size_t offset)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		sum += *(u64 *)((char *)per_cpu_ptr(node->stats, cpu) + offset);
+	}
+	return sum;
+}
+#define STAT_SUM(node, field) sumStat(node, offsetof(struct reversi_stats, field))
+
+/*
+* take in node,
+* return nodes per second over every computer move searched so far
+*/
+static u64 searchNps(struct reversi_data * node)
+{
+	u64 ns = STAT_SUM(node, searchNs);
+
+	return ns ? mul_u64_u64_div_u64(STAT_SUM(node, searchNodes), NSEC_PER_SEC, ns) : 0;
+}
+
+static ssize_t errors_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%llu\n", STAT_SUM(node, commands[STAT_ERROR]));
+}
+static DEVICE_ATTR_RO(errors);
+
+static ssize_t search_nodes_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%llu\n", STAT_SUM(node, searchNodes));
+}
+static DEVICE_ATTR_RO(search_nodes);
+
+static ssize_t search_nps_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct reversi_data * node = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%llu\n", searchNps(node));
+}
+static DEVICE_ATTR_RO(search_nps);
+
+static struct attribute *reversi_attrs[] = {
+	&dev_attr_sessions.attr,
+	&dev_attr_spectators.attr,
+	&dev_attr_opens.attr,
+	&dev_attr_commands.attr,
+	&dev_attr_games.attr,
+	&dev_attr_errors.attr,
+	&dev_attr_search_nodes.attr,
+	&dev_attr_search_nps.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(reversi);
+
+/*
+* search scheduler, global so in /sys/class/reversiClass/ itself.
+* search_queued is the total waiting, then one line per class of
+* waiting and slots granted since load.
+*/
+static ssize_t search_running_show(struct class *class, struct class_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(sched.running));
+}
+static CLASS_ATTR_RO(search_running);
+
+static ssize_t search_queued_show(struct class *class, struct class_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(sched.queuedAll));
+}
+static CLASS_ATTR_RO(search_queued);
+
+static ssize_t search_classes_show(struct class *class, struct class_attribute *attr, char *buf)
+{
+	int qos, len = 0;
+
+	spin_lock(&sched.lock);
+	for (qos = 0; qos < QOS_CLASSES; qos++) {
+		len += sysfs_emit_at(buf, len, "%s %u %lu\n", QOS_NAMES[qos], sched.queued[qos], sched.granted[qos]);
+	}
+	spin_unlock(&sched.lock);
+	return len;
+}
+static CLASS_ATTR_RO(search_classes);
+
+static struct class_attribute * const sched_attrs[] = {
+	&class_attr_search_running,
+	&class_attr_search_queued,
+	&class_attr_search_classes,
+};
+
+/*
+* debugfs reversi/<node>, everything in struct reversi_stats.
+* Latency rows are the low end of each log2 bucket in ns, empty rows skipped.
+*/
+static const char * const STAT_NAMES[STAT_KINDS] = {
+	[STAT_NEW_GAME] = "00",
+	[STAT_GET_BOARD] = "01",
+	[STAT_HUMAN_MOVE] = "02",
+	[STAT_COMPUTER_MOVE] = "03",
+	[STAT_PASS] = "04",
+	[STAT_PERFT] = "05",
+	[STAT_EVALUATE] = "eval",
+	[STAT_ERROR] = "error",
+};
+
+static int reversi_stats_show(struct seq_file *m, void *v)
+{
+	struct reversi_data * node = m->private;
+	u64 row[STAT_KINDS], any;
+	int kind, bucket;
+
+	seq_printf(m, "sessions %d\n", atomic_read(&node->activeSessions));
+	seq_printf(m, "session_allocs %llu\n", STAT_SUM(node, sessionAllocs));
+	seq_printf(m, "session_frees %llu\n", STAT_SUM(node, sessionFrees));
+	seq_printf(m, "alloc_failures %llu\n", STAT_SUM(node, allocFailures));
+	seq_printf(m, "searches %llu\n", STAT_SUM(node, searches));
+	seq_printf(m, "search_nodes %llu\n", STAT_SUM(node, searchNodes));
+	seq_printf(m, "search_ns %llu\n", STAT_SUM(node, searchNs));
+	seq_printf(m, "search_nps %llu\n", searchNps(node));
+	seq_printf(m, "ponder_searches %llu\n", STAT_SUM(node, ponderSearches));
+	seq_printf(m, "ponder_hits %llu\n", STAT_SUM(node, ponderHits));
+	seq_printf(m, "eval_positions %llu\n", STAT_SUM(node, evalPositions));
+
+	seq_puts(m, "\ncommand");
+	for (kind = 0; kind < STAT_KINDS; kind++) {
+		seq_printf(m, "\t%s", STAT_NAMES[kind]);
+	}
+	seq_puts(m, "\ncount");
+	for (kind = 0; kind < STAT_KINDS; kind++) {
+		seq_printf(m, "\t%llu", STAT_SUM(node, commands[kind]));
+	}
+	seq_puts(m, "\n");
+	for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+		any = 0;
+		for (kind = 0; kind < STAT_KINDS; kind++) {
+			row[kind] = STAT_SUM(node, latency[kind][bucket]);
+			any |= row[kind];
+		}
+		if (!any) {
+			continue;
+		}
+		seq_printf(m, "%lluns", 1ULL << bucket);
+		for (kind = 0; kind < STAT_KINDS; kind++) {
+			seq_printf(m, "\t%llu", row[kind]);
+		}
+		seq_puts(m, "\n");
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(reversi_stats);
+
+/*
+* take in nothing,
+* free every node's stats, nodes never set up have none
+*/
+static void free_reversi_stats(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_devices; i++) {
+		free_percpu(devs[i].stats);
+	}
+}
+
+/*
+* specify default permissions
+*/
+static int reversi_uevent(struct device *dev, struct kobj_uevent_env *env){
+	add_uevent_var(env, "DEVMODE=%#o", 0666);
+	return 0; 
+}
+
+/*
+* take in how many nodes were fully set up,
+* remove their device nodes and cdevs, highest minor first
+*/
+static void destroy_reversi_nodes(unsigned int count)
+{
+	while (count-- > 0) {
+		if (devs[count].dev != NULL) {
+			device_destroy(reversi_class, MKDEV(MAJOR(majMinor), count));
+		}
+		cdev_del(&devs[count].reversi_cdev);
+	}
+}
+
+/*
+* init and exit 
+*/
+static int __init init_reversi(void){
+	int err, check, reversi_dev_major; 
+	unsigned int i;
+    struct device *dev_ret; 
+
+	if (nr_devices < 1 || nr_devices > REVERSI_MAX_MINORS) {
+		printk(KERN_ALERT "Reversi nr_devices must be between 1 and %d\n", REVERSI_MAX_MINORS);
+		return -EINVAL;
+	}
+
+	session_cache = KMEM_CACHE(reversi_session, SLAB_HWCACHE_ALIGN | SLAB_ACCOUNT);
+	if (session_cache == NULL) {
+		return -ENOMEM;
+	}
+
+	devs = kcalloc(nr_devices, sizeof(*devs), GFP_KERNEL);
+	if (devs == NULL) {
+		kmem_cache_destroy(session_cache);
+		return -ENOMEM;
+	}
+	reversi_wq = alloc_workqueue("reversi", WQ_UNBOUND, 0);
+	search_wq = alloc_workqueue("reversi_search", WQ_UNBOUND, 0);
+	if (reversi_wq == NULL || search_wq == NULL) {
+		if (reversi_wq != NULL) {
+			destroy_workqueue(reversi_wq);
+		}
+		if (search_wq != NULL) {
+			destroy_workqueue(search_wq);
+		}
+		kfree(devs);
+		kmem_cache_destroy(session_cache);
+		return -ENOMEM;
+	}
+	spin_lock_init(&sched.lock);
+	for (i = 0; i < QOS_CLASSES; i++) {
+		INIT_LIST_HEAD(&sched.queue[i]);
+	}
+	initZobrist();
+	initPatterns();
+	if (initTransTable(tt_size_mb)) {
+		printk(KERN_WARNING "Reversi could not allocate a %u MiB transposition table, searching without one\n",
+			tt_size_mb);
+	}
+
+	/*dynamic allocation major number to character device, flexible */
+    /*error check*/
+	err = alloc_chrdev_region(&majMinor, 
+								0, 
+								nr_devices,
+								DEVICE_NAME); 
+
+	if (err != 0) {
+        printk(KERN_ALERT "Reversi failed to register a major number\n");
+		kfree(devs);
+		freeEngineTables();
+		destroy_workqueue(reversi_wq);
+		destroy_workqueue(search_wq);
+		kmem_cache_destroy(session_cache);
+		return err;
+	}
+
+    /*this is the dyanmically allocated major number*/
+	reversi_dev_major = MAJOR(majMinor);
+    printk(KERN_INFO "Reversi device registered correctly with major number %d\n", reversi_dev_major);
+
+	/*
+	* Create sysfs class in order to access device from user space.
+	* to see tree, print out w/ "tree /sys/devices/virtual/reversi/ 
+    * check class pointer reversi_class for error
+    * report success or return failure after clean up
+	*/
+	reversi_class = class_create(THIS_MODULE, DEVICE_CLASS);
+    if(IS_ERR(reversi_class)){
+        unregister_chrdev_region(majMinor, nr_devices);
+		kfree(devs);
+		freeEngineTables();
+		destroy_workqueue(reversi_wq);
+		destroy_workqueue(search_wq);
+		kmem_cache_destroy(session_cache);
+        printk(KERN_ALERT "Failed to register reversi_class\n");
+        return PTR_ERR(reversi_class);
+    }
+    printk(KERN_INFO "Reversi_class registered correctly\n");
+
+    /*set the permissions for the new file available in user space*/
+	reversi_class->dev_uevent = reversi_uevent;
+	/*best effort like debugfs, scheduling does not depend on them*/
+	for (i = 0; i < ARRAY_SIZE(sched_attrs); i++) {
+		if (class_create_file(reversi_class, sched_attrs[i])) {
+			printk(KERN_WARNING "Reversi could not add %s to sysfs\n", sched_attrs[i]->attr.name);
+		}
+	}
+
+	debugfsDir = debugfs_create_dir(DEVICE_NAME, NULL);
+
+	for (i = 0; i < nr_devices; i++) {
+		spin_lock_init(&devs[i].lock);
+		INIT_LIST_HEAD(&devs[i].sessions);
+		xa_init_flags(&devs[i].views, XA_FLAGS_ALLOC1);
+		devs[i].stats = alloc_percpu(struct reversi_stats);
+		if (devs[i].stats == NULL) {
+			check = -ENOMEM;
+			goto fail;
+		}
+
+		cdev_init(&devs[i].reversi_cdev, &reversi_fops);
+		devs[i].reversi_cdev.owner = THIS_MODULE;
+
+		/*Add device to system = live immediately. "i" is the Minor number of the new device.*/
+		/*check for rare cdev_add failure*/
+		check = cdev_add(&devs[i].reversi_cdev, MKDEV(reversi_dev_major, i), 1);
+		if (check) {
+			printk(KERN_ALERT "Error %d adding %s%u", check, DEVICE_NAME, i);
+			goto fail;
+		}
+
+		/*create device node, /dev/reversi alone, else /dev/reversiN for minor N*/
+		if (nr_devices == 1) {
+			dev_ret = device_create_with_groups(reversi_class, NULL, MKDEV(reversi_dev_major, i),
+								&devs[i], reversi_groups, DEVICE_NAME);
+		} else {
+			dev_ret = device_create_with_groups(reversi_class, NULL, MKDEV(reversi_dev_major, i),
+								&devs[i], reversi_groups, DEVICE_NAME "%u", i);
+		}
+		if (IS_ERR(dev_ret)) {
+			printk(KERN_ALERT "Failed to create reversi device %u\n", i);
+			check = PTR_ERR(dev_ret);
+			/*cdev for minor i is live, tear it down with the others*/
+			i++;
+			goto fail;
+		}
+		devs[i].dev = dev_ret;
+		/*debugfs is best effort, nothing depends on it*/
+		debugfs_create_file(dev_name(dev_ret), 0444, debugfsDir, &devs[i], &reversi_stats_fops);
+	}
+    printk(KERN_INFO "Reversi devices created and added to kernel correctly\n");
+
+	/*firmware lookups want a device, any of ours will do*/
+	loadOpeningBook(devs[0].dev);
+	loadEvalWeights(devs[0].dev);
+
+    printk(KERN_INFO "init_reversi complete");
+	return 0;
+
+fail:
+	debugfs_remove_recursive(debugfsDir);
+	destroy_reversi_nodes(i);
+	free_reversi_stats();
+	class_destroy(reversi_class);
+	unregister_chrdev_region(majMinor, nr_devices);
+	kfree(devs);
+	freeEngineTables();
+	destroy_workqueue(reversi_wq);
+	destroy_workqueue(search_wq);
+	kmem_cache_destroy(session_cache);
+	return check;
+}
+
+static void __exit cleanup_reversi(void){ 
+	unsigned int i;
+
+ 	printk(KERN_INFO "cleanup_reversi started");
+ 	
+    /*delete devices from system
+    * destroy devices
+    * unregister and destroy class
+    * release major and minor numbers*/
+	debugfs_remove_recursive(debugfsDir);
+	destroy_reversi_nodes(nr_devices);
+	free_reversi_stats();
+    printk(KERN_INFO "device_destroy and cdev_del FINISHED 1");
+
+	for (i = 0; i < ARRAY_SIZE(sched_attrs); i++) {
+		class_remove_file(reversi_class, sched_attrs[i]);
+	}
+	/*class_destroy unregisters the class itself*/
+ 	class_destroy(reversi_class);
+    printk(KERN_INFO "class_destroy FINISHED 2");
+
+ 	unregister_chrdev_region(majMinor, nr_devices);
+	kfree(devs);
+	freeEngineTables();
+	destroy_workqueue(reversi_wq);
+	destroy_workqueue(search_wq);
+	/*sessions freed after a grace period still need the cache*/
+	rcu_barrier();
+	kmem_cache_destroy(session_cache);
+    printk(KERN_INFO "cleanup_reversi FINISHED DONE"); 
+}
+
+
+module_init(init_reversi);
+module_exit(cleanup_reversi);
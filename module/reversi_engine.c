@@ -0,0 +1,1265 @@
+/* file: reversi_engine.c
+* description: Board, move generation, evaluation and search for reversi,
+*	a.k.a. Othello. Nothing here knows about files, sessions or module
+*	parameters, callers pass budgets in and hand over table contents,
+*	so the same source builds into the kernel module and in user space.
+*/
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>	/* ARRAY_SIZE, clamp */
+#include <linux/errno.h>	/* for ERRORs */
+#include <linux/string.h>	/* memset */
+#include <linux/ktime.h>	/* search deadline */
+#include <linux/timekeeping.h>	/* ktime_get */
+#include <linux/sched.h>	/* cond_resched during long searches */
+#include <linux/jiffies.h>	/* transposition table ageing */
+#include <linux/vmalloc.h>	/* transposition table, book and weights */
+#include <linux/hash.h>		/* opening book slots */
+#include <linux/swab.h>		/* board symmetries */
+#include <linux/log2.h>		/* opening book size */
+#include <linux/bitops.h>	/* for hweight64 and __ffs64 on bitboards */
+#include <asm/unaligned.h>	/* opening book and weights files */
+#endif
+#include "reversi_engine.h"
+
+static const int DIRECTIONS[] = {-9, -8, -7, -1, 1, 7, 8, 9};
+/* squares a run may pass through in each direction without wrapping a row */
+static const u64 DIR_MASKS[] = {
+	~(FILE_A | FILE_H), ~0ULL, ~(FILE_A | FILE_H), ~(FILE_A | FILE_H),
+	~(FILE_A | FILE_H), ~(FILE_A | FILE_H), ~0ULL, ~(FILE_A | FILE_H)
+};
+
+/*
+* zobrist keys, one per colour per square, plus the key xored in
+* when white is to move. zobristFlip[sq] swaps the colour on sq.
+*/
+static u64 zobristKeys[2][BOARDSIZE];
+static u64 zobristFlip[BOARDSIZE];
+static u64 zobristWhiteToMove;
+
+/*
+* pattern instances read a line or block of squares as a base 3 number,
+* first square lowest digit, 0 empty, 1 black, 2 white. Every instance
+* of a pattern is a symmetric image of the one below and shares its
+* weight table. squareRefs lists the instances each square feeds.
+*/
+struct pattern_def {
+	u8 len;
+	u8 syms; /* bit n set when transformBoard symmetry n gives an instance */
+	u8 squares[PATTERN_MAX_LEN];
+};
+
+static const struct pattern_def PATTERNS[] = {
+	/* edge */
+	{ 8, 0x33, { SQUARE(0, 0), SQUARE(1, 0), SQUARE(2, 0), SQUARE(3, 0),
+		SQUARE(4, 0), SQUARE(5, 0), SQUARE(6, 0), SQUARE(7, 0) } },
+	/* 3x3 corner */
+	{ 9, 0x0f, { SQUARE(0, 0), SQUARE(1, 0), SQUARE(2, 0), SQUARE(0, 1), SQUARE(1, 1),
+		SQUARE(2, 1), SQUARE(0, 2), SQUARE(1, 2), SQUARE(2, 2) } },
+	/* 2x5 corner block */
+	{ 10, 0xff, { SQUARE(0, 0), SQUARE(1, 0), SQUARE(2, 0), SQUARE(3, 0), SQUARE(4, 0),
+		SQUARE(0, 1), SQUARE(1, 1), SQUARE(2, 1), SQUARE(3, 1), SQUARE(4, 1) } },
+	/* diagonals of 8 down to 4 squares, flips alone reach every image of the shorter ones */
+	{ 8, 0x03, { SQUARE(0, 0), SQUARE(1, 1), SQUARE(2, 2), SQUARE(3, 3),
+		SQUARE(4, 4), SQUARE(5, 5), SQUARE(6, 6), SQUARE(7, 7) } },
+	{ 7, 0x0f, { SQUARE(1, 0), SQUARE(2, 1), SQUARE(3, 2), SQUARE(4, 3),
+		SQUARE(5, 4), SQUARE(6, 5), SQUARE(7, 6) } },
+	{ 6, 0x0f, { SQUARE(2, 0), SQUARE(3, 1), SQUARE(4, 2), SQUARE(5, 3), SQUARE(6, 4), SQUARE(7, 5) } },
+	{ 5, 0x0f, { SQUARE(3, 0), SQUARE(4, 1), SQUARE(5, 2), SQUARE(6, 3), SQUARE(7, 4) } },
+	{ 4, 0x0f, { SQUARE(4, 0), SQUARE(5, 1), SQUARE(6, 2), SQUARE(7, 3) } },
+};
+
+struct pattern_ref {
+	u8 instance;
+	u16 pow3; /* value of one digit on this square in that instance */
+};
+
+static struct pattern_ref squareRefs[BOARDSIZE][PATTERN_REFS_MAX];
+static u8 squareRefCount[BOARDSIZE];
+/* start of each instance's weight table in evalWeights */
+static u32 instanceTable[PATTERN_INSTANCES];
+/* weights in use once loadEvalWeights publishes them, evalWeightsLen long */
+static s16 * evalWeights;
+static u32 evalWeightsLen;
+
+/*
+* transposition table slot, written and read without locks.
+* key holds hash ^ data, so a slot torn by a racing writer fails the
+* check in probeTable instead of handing back another position's data.
+* data packs score (bits 0-31), move (32-39), depth (40-47),
+* bound (48-55) and age (56-63).
+*/
+struct tt_entry {
+	u64 key;
+	u64 data;
+};
+
+/* shared by every session on every node, ttMask + 1 slots */
+static struct tt_entry * transTable;
+static u64 ttMask;
+
+/*
+* opening book slot, open addressed with linear probing.
+* Positions are canonical and from the mover's side, see canonicalPosition.
+* A slot with no discs at all is empty, no real position has none.
+*/
+struct book_entry {
+	u64 own;
+	u64 opp;
+	u8 move; /* in the canonical orientation */
+};
+
+/* NULL until loadOpeningBook publishes it, 1 << bookBits slots */
+static struct book_entry * openingBook;
+static unsigned int bookBits;
+
+/*
+* board and game functions
+*/
+
+/*
+* take in board,
+* clear it and place the four starting tokens
+*/
+void setupBoard(struct reversi_board * board) {
+	loadBoard(board, BIT_ULL(SQUARE(4, 3)) | BIT_ULL(SQUARE(3, 4)), BIT_ULL(SQUARE(3, 3)) | BIT_ULL(SQUARE(4, 4)));
+}
+
+/*
+* take in board and the squares each colour holds, which must not overlap,
+* set the board to that position with everything derived from it
+*/
+void loadBoard(struct reversi_board * board, u64 black, u64 white) {
+	board->discs[PLAYER_BLACK] = black;
+	board->discs[PLAYER_WHITE] = white;
+	board->hash = hashBoard(board);
+	board->count[PLAYER_BLACK] = hweight64(black);
+	board->count[PLAYER_WHITE] = hweight64(white);
+	computePatterns(board);
+	board->frontier[PLAYER_BLACK] = findNeighbours(black) & ~(black | white);
+	board->frontier[PLAYER_WHITE] = findNeighbours(white) & ~(black | white);
+	board->moves[PLAYER_BLACK] = findLegalMoves(black, white);
+	board->moves[PLAYER_WHITE] = findLegalMoves(white, black);
+}
+
+/*
+* take in nothing,
+* fill the zobrist keys from a fixed seed so hashes are the same every load
+*/
+void initZobrist(void) {
+	int i;
+	u64 seed, z, keys[2 * BOARDSIZE + 1];
+	seed = ZOBRIST_SEED;
+
+	/*splitmix64*/
+	for (i = 0; i < ARRAY_SIZE(keys); i++) {
+		z = (seed += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		keys[i] = z ^ (z >> 31);
+	}
+	for (i = 0; i < BOARDSIZE; i++) {
+		zobristKeys[PLAYER_BLACK][i] = keys[i];
+		zobristKeys[PLAYER_WHITE][i] = keys[BOARDSIZE + i];
+		zobristFlip[i] = keys[i] ^ keys[BOARDSIZE + i];
+	}
+	zobristWhiteToMove = keys[2 * BOARDSIZE];
+}
+
+/*
+* take in board
+* return zobrist hash of its discs, computed from scratch
+*/
+u64 hashBoard(const struct reversi_board * board) {
+	int player;
+	u64 tokens, hash;
+	hash = 0;
+	for (player = PLAYER_BLACK; player <= PLAYER_WHITE; player++) {
+		for (tokens = board->discs[player]; tokens; tokens &= tokens - 1) {
+			hash ^= zobristKeys[player][__ffs64(tokens)];
+		}
+	}
+	return hash;
+}
+
+
+/*
+* take in board and direction index,
+* shift every token one square in that direction.
+* Callers mask away tokens that would wrap around an edge.
+*/
+static inline u64 shiftBoard(u64 tokens, int i) {
+	int dir = DIRECTIONS[i];
+	return (dir > 0) ? (tokens << dir) : (tokens >> -dir);
+}
+
+/*
+* take in the tokens of the player to move and of the opponent,
+* flood out from every player token along all eight directions
+* across runs of opponent tokens.
+* return mask of every empty square that brackets at least one run.
+*/
+u64 findLegalMoves(u64 own, u64 opp) {
+	int i;
+	u64 empty, run, inner, moves;
+	empty = ~(own | opp);
+	moves = 0;
+
+	for (i = 0; i <= 7; i++) {
+		/* an opponent run can never continue through the edge it runs into */
+		inner = opp & DIR_MASKS[i];
+		run = shiftBoard(own, i) & inner;
+		run |= shiftBoard(run, i) & inner;
+		run |= shiftBoard(run, i) & inner;
+		run |= shiftBoard(run, i) & inner;
+		run |= shiftBoard(run, i) & inner;
+		run |= shiftBoard(run, i) & inner;
+		moves |= shiftBoard(run, i) & empty;
+	}
+	return moves;
+}
+
+/*
+* take in tokens,
+* return mask of every square touching one of them, the tokens' own squares
+* included only where two tokens touch
+*/
+u64 findNeighbours(u64 tokens) {
+	u64 sides;
+	sides = ((tokens << 1) & ~FILE_A) | ((tokens >> 1) & ~FILE_H);
+	tokens |= sides;
+	return sides | (tokens << 8) | (tokens >> 8);
+}
+
+/*
+* take in move and the tokens of the player to move and of the opponent,
+* walk every direction across opponent tokens looking for a bracket.
+* return mask of opponent tokens the move would flip, zero if none.
+*/
+u64 findFlips(int move, u64 own, u64 opp) {
+	int i;
+	u64 flips, run, next, inner;
+	flips = 0;
+
+	for (i = 0; i <= 7; i++) {
+		inner = opp & DIR_MASKS[i];
+		run = 0;
+		next = shiftBoard(BIT_ULL(move), i) & inner;
+		while (next) {
+			run |= next;
+			next = shiftBoard(next, i);
+			if (next & own) {
+				/*bracket found, the whole run flips*/
+				flips |= run;
+				break;
+			}
+			next &= inner;
+		}
+	}
+	return flips;
+}
+
+/*
+* take in player and board
+* return number of tokens player has on the board
+*/
+int countToken(int player, const struct reversi_board * board) {
+	return board->count[player];
+}
+
+/*
+* take in move,
+* check move is on the board,
+* check for availability of move,
+* when move available, check for flips
+* no flips, return illegal move
+* flips found, return legal move
+*/
+int checkForLegal(int move, int player, const struct reversi_board * board)
+{
+	/*check if move is on the board*/
+	if (move < 0 || move >= BOARDSIZE) {
+		return 0;
+	}
+	/*check if move is occupied*/
+	if ((board->discs[PLAYER_BLACK] | board->discs[PLAYER_WHITE]) & BIT_ULL(move)) {
+		return 0;
+	}
+	/*flip possible in at least one direction, legal move*/
+	return findFlips(move, board->discs[player], board->discs[OPPONENT(player)]) != 0;
+}
+
+/*
+* call after findFlips,
+* take in move, player, board, and the tokens to flip,
+* place token on move and flip opponent tokens, updating the hash,
+* counts, frontiers and pattern indices to match. The legal move sets are
+* recomputed, a flip anywhere can open or close moves anywhere, and so is
+* the opponent's frontier, which loses squares next to flipped discs.
+*/
+void flipTokens(int move, int player, struct reversi_board * board, u64 flips) {
+	int i, sq, flipped, flipDelta;
+	u64 own, opp;
+
+	/*new disc adds its colour's digit, a flip to player moves it one up or down*/
+	for (i = 0; i < squareRefCount[move]; i++) {
+		board->patterns[squareRefs[move][i].instance] += (player + 1) * squareRefs[move][i].pow3;
+	}
+	flipDelta = (player == PLAYER_BLACK) ? -1 : 1;
+	for (own = flips; own; own &= own - 1) {
+		sq = __ffs64(own);
+		for (i = 0; i < squareRefCount[sq]; i++) {
+			board->patterns[squareRefs[sq][i].instance] += flipDelta * squareRefs[sq][i].pow3;
+		}
+	}
+
+	own = board->discs[player] | flips | BIT_ULL(move);
+	opp = board->discs[OPPONENT(player)] & ~flips;
+	board->discs[player] = own;
+	board->discs[OPPONENT(player)] = opp;
+	flipped = hweight64(flips);
+	board->count[player] += flipped + 1;
+	board->count[OPPONENT(player)] -= flipped;
+	/*player's discs only grow, the opponent's shrink and are redone*/
+	board->frontier[player] = (board->frontier[player] | findNeighbours(flips | BIT_ULL(move))) & ~(own | opp);
+	board->frontier[OPPONENT(player)] = findNeighbours(opp) & ~(own | opp);
+	board->moves[player] = findLegalMoves(own, opp);
+	board->moves[OPPONENT(player)] = findLegalMoves(opp, own);
+	board->hash ^= zobristKeys[player][move];
+	for (; flips; flips &= flips - 1) {
+		board->hash ^= zobristFlip[__ffs64(flips)];
+	}
+}
+
+/*
+* call after checkForLegal
+* Take in move, player, board.
+* Flip bracketed tokens in all directions
+*/
+void makeYourMove(int move, int player, struct reversi_board * board) {
+	u64 flips;
+	flips = findFlips(move, board->discs[player], board->discs[OPPONENT(player)]);
+	flipTokens(move, player, board, flips);
+}
+
+/*
+* take in player and board,
+* return mask of all legal moves for player
+*/
+u64 tallyLegalMoves(int player, const struct reversi_board * board) {
+	return board->moves[player];
+}
+
+/*
+* take in player and board,
+* return 1 if even one legal move is found for player
+*/
+int lookForLegalMove(int player, const struct reversi_board * board) {
+	return tallyLegalMoves(player, board) != 0;
+}
+
+/*
+* take in board and previous player,
+* check if next/previous player has even 1 legal move.
+* return next player, previous player, or NO_PLAYER when neither can move.
+*/
+int checkNextPlayer(const struct reversi_board * board, int prevPlayer) {
+	if (lookForLegalMove(OPPONENT(prevPlayer), board)) {
+		return OPPONENT(prevPlayer);
+	}
+	if (lookForLegalMove(prevPlayer, board)) {
+		return prevPlayer;
+	}
+	return NO_PLAYER;
+}
+
+/*
+* take in player and board.
+* count respective pieces
+* return difference. Positive return = player win.
+* Negative return = computer win.
+*/
+int figureWhoWon(int player, const struct reversi_board * board) {
+	return countToken(player, board) - countToken(OPPONENT(player), board);
+}
+
+/*
+* take in board, player to move, and output buffer of BOARD_LEN + 1.
+* write out the 64 squares row by row, then tab, next player, newline.
+*/
+void renderBoard(const struct reversi_board * board, int nextPlayer, char * out) {
+	int i;
+	for (i = 0; i < BOARDSIZE; i++) {
+		if (board->discs[PLAYER_BLACK] & BIT_ULL(i)) {
+			out[i] = *BLACK;
+		} else if (board->discs[PLAYER_WHITE] & BIT_ULL(i)) {
+			out[i] = *WHITE;
+		} else {
+			out[i] = *EMPTY;
+		}
+	}
+	out[BOARDSIZE] = '\t';
+	out[BOARDSIZE + 1] = TOKENS[nextPlayer];
+	out[BOARDSIZE + 2] = '\n';
+	out[BOARD_LEN] = '\0';
+}
+
+/*
+* computer player, negamax alpha-beta search with iterative deepening
+*/
+
+/*
+* positional value of each square, corners good, squares that give corners away bad
+*/
+static const s8 SQUARE_WEIGHTS[BOARDSIZE] = {
+	100, -20,  10,   5,   5,  10, -20, 100,
+	-20, -50,  -2,  -2,  -2,  -2, -50, -20,
+	 10,  -2,  -1,  -1,  -1,  -1,  -2,  10,
+	  5,  -2,  -1,  -1,  -1,  -1,  -2,   5,
+	  5,  -2,  -1,  -1,  -1,  -1,  -2,   5,
+	 10,  -2,  -1,  -1,  -1,  -1,  -2,  10,
+	-20, -50,  -2,  -2,  -2,  -2, -50, -20,
+	100, -20,  10,   5,   5,  10, -20, 100
+};
+
+/* moves are tried corners first, then plain squares, then next to corners */
+static const u64 MOVE_ORDER[] = {
+	CORNERS, ~(CORNERS | CORNER_NEIGHBOURS), CORNER_NEIGHBOURS
+};
+
+/*
+* take in search and the per move budget: wall clock ms and nodes,
+* 0 for no limit, and the deepest iteration to search
+*/
+void initSearch(struct reversi_search * search, unsigned int timeMs, u64 nodeLimit, unsigned int maxDepth) {
+	search->useDeadline = timeMs != 0;
+	search->deadline = ktime_add_ms(ktime_get(), timeMs);
+	search->nodeLimit = nodeLimit;
+	search->maxDepth = maxDepth;
+	search->nodes = 0;
+	search->stopped = 0;
+	search->bestMove = -1;
+	search->score = 0;
+	search->depth = 0;
+	search->stopAll = NULL;
+	search->waiting = NULL;
+	search->yielded = 0;
+}
+
+/*
+* take in search,
+* return nonzero once its time or node budget is spent
+*/
+int searchBudgetSpent(const struct reversi_search * search) {
+	if (search->nodeLimit && search->nodes >= search->nodeLimit) {
+		return 1;
+	}
+	return search->useDeadline && ktime_after(ktime_get(), search->deadline);
+}
+
+/*
+* take in search,
+* called every SEARCH_CHECK_NODES nodes,
+* set stopped once the time or node budget is spent, and yielded as well
+* only when the search stopped for others waiting with budget left
+*/
+static void checkSearchBudget(struct reversi_search * search) {
+	if (searchBudgetSpent(search) || (search->stopAll != NULL && READ_ONCE(*search->stopAll))) {
+		search->stopped = 1;
+	} else if (search->waiting != NULL && READ_ONCE(*search->waiting) && ktime_after(ktime_get(), search->sliceEnd)) {
+		search->stopped = 1;
+		search->yielded = 1;
+	}
+	cond_resched();
+}
+
+/*
+* take in search from initSearch or NULL for no budget, board, player to move,
+* plies left and whether the last ply was a pass.
+* walk every line of play through makeYourMove, a forced pass counting as a ply.
+* return number of positions reached after depth plies, or earlier at game end,
+* meaningless once the budget runs out and sets search->stopped
+*/
+u64 perft(struct reversi_search * search, const struct reversi_board * board, int player, unsigned int depth,
+		int passed) {
+	struct reversi_board child;
+	u64 moves, leaves;
+
+	if (depth == 0) {
+		return 1;
+	}
+	moves = tallyLegalMoves(player, board);
+	if (!moves) {
+		/*two passes in a row ends the game*/
+		if (passed) {
+			return 1;
+		}
+		return perft(search, board, OPPONENT(player), depth - 1, 1);
+	}
+	if (depth == 1) {
+		/*the move sets are exact, no need to play the last ply out*/
+		return hweight64(moves);
+	}
+	if (depth >= PERFT_RESCHED_DEPTH) {
+		if (search == NULL) {
+			cond_resched();
+		} else {
+			/*yields the CPU too*/
+			checkSearchBudget(search);
+			if (search->stopped) {
+				return 0;
+			}
+		}
+	}
+	leaves = 0;
+	for (; moves; moves &= moves - 1) {
+		child = *board;
+		makeYourMove(__ffs64(moves), player, &child);
+		leaves += perft(search, &child, OPPONENT(player), depth - 1, 0);
+	}
+	return leaves;
+}
+
+/*
+* take in board and player to move
+* return hash of the position including the side to move
+*/
+static inline u64 positionKey(const struct reversi_board * board, int player) {
+	return player == PLAYER_WHITE ? board->hash ^ zobristWhiteToMove : board->hash;
+}
+
+/*
+* take in table size in MiB, 0 for none,
+* allocate the shared transposition table, rounded down to a power of two.
+* return 0, or -ENOMEM and searches simply go without a table
+*/
+int initTransTable(unsigned int sizeMb) {
+	u64 slots;
+
+	if (sizeMb == 0) {
+		return 0;
+	}
+	slots = rounddown_pow_of_two(((u64)sizeMb << 20) / sizeof(struct tt_entry));
+	transTable = vzalloc(slots * sizeof(struct tt_entry));
+	if (transTable == NULL) {
+		return -ENOMEM;
+	}
+	ttMask = slots - 1;
+	return 0;
+}
+
+/*
+* take in position key,
+* return packed data of the matching slot, or 0 when the position is not stored
+*/
+static u64 probeTable(u64 key) {
+	struct tt_entry * e;
+	u64 data;
+
+	if (transTable == NULL) {
+		return 0;
+	}
+	e = &transTable[key & ttMask];
+	data = READ_ONCE(e->data);
+	if ((READ_ONCE(e->key) ^ data) != key) {
+		return 0;
+	}
+	return data;
+}
+
+/*
+* take in position key and what the search found there,
+* overwrite the slot unless it holds a deeper result for another
+* position stored within the last second or so
+*/
+static void storeTable(u64 key, int score, int move, int depth, int bound) {
+	struct tt_entry * e;
+	u64 old, data;
+	u8 age;
+
+	if (transTable == NULL) {
+		return;
+	}
+	age = (u8)(jiffies / HZ);
+	e = &transTable[key & ttMask];
+	old = READ_ONCE(e->data);
+	if ((READ_ONCE(e->key) ^ old) != key && (u8)(old >> 56) == age && (int)((old >> 40) & 0xff) > depth) {
+		return;
+	}
+	data = (u32)score | ((u64)(u8)move << 32) | ((u64)(u8)depth << 40) |
+		((u64)bound << 48) | ((u64)age << 56);
+	WRITE_ONCE(e->key, key ^ data);
+	WRITE_ONCE(e->data, data);
+}
+
+/*
+* opening book
+*/
+
+/*
+* take in bitboard and symmetry 0-7,
+* return it flipped top to bottom when bit 0 is set, left to right
+* when bit 1 is set, then across the a1-h8 diagonal when bit 2 is set
+*/
+static u64 transformBoard(u64 x, int sym) {
+	u64 t;
+
+	if (sym & 1) {
+		/*rows are bytes*/
+		x = swab64(x);
+	}
+	if (sym & 2) {
+		/*columns are bits within each byte*/
+		x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+		x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+		x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	}
+	if (sym & 4) {
+		/*swap rows and columns in three block swaps*/
+		t = 0x0F0F0F0F00000000ULL & (x ^ (x << 28));
+		x ^= t ^ (t >> 28);
+		t = 0x3333000033330000ULL & (x ^ (x << 14));
+		x ^= t ^ (t >> 14);
+		t = 0x5500550055005500ULL & (x ^ (x << 7));
+		x ^= t ^ (t >> 7);
+	}
+	return x;
+}
+
+/*
+* take in the mover's and opponent's discs and where to put the canonical pair,
+* pick the smallest of the 8 symmetric images, own discs compared first.
+* return the symmetry that produces it
+*/
+static int canonicalPosition(u64 own, u64 opp, u64 * canonOwn, u64 * canonOpp) {
+	int sym, best;
+	u64 o, p;
+
+	best = 0;
+	*canonOwn = own;
+	*canonOpp = opp;
+	for (sym = 1; sym < 8; sym++) {
+		o = transformBoard(own, sym);
+		p = transformBoard(opp, sym);
+		if (o < *canonOwn || (o == *canonOwn && p < *canonOpp)) {
+			*canonOwn = o;
+			*canonOpp = p;
+			best = sym;
+		}
+	}
+	return best;
+}
+
+/*
+* take in a canonical position and table size in bits,
+* return its first slot
+*/
+static inline u32 bookSlot(u64 own, u64 opp, unsigned int bits) {
+	return hash_64(own ^ swab64(opp), bits);
+}
+
+/*
+* take in board and player to move,
+* return the book move for this position in any orientation, or -1
+*/
+int probeBook(const struct reversi_board * board, int player) {
+	struct book_entry * book;
+	u64 own, opp, moves;
+	u32 slot, mask;
+	int sym;
+
+	book = smp_load_acquire(&openingBook);
+	if (book == NULL) {
+		return -1;
+	}
+	mask = (1U << bookBits) - 1;
+	sym = canonicalPosition(board->discs[player], board->discs[OPPONENT(player)], &own, &opp);
+	for (slot = bookSlot(own, opp, bookBits); book[slot].own | book[slot].opp; slot = (slot + 1) & mask) {
+		if (book[slot].own != own || book[slot].opp != opp) {
+			continue;
+		}
+		/*turn the book square back into this orientation, legal moves only*/
+		for (moves = tallyLegalMoves(player, board); moves; moves &= moves - 1) {
+			if (transformBoard(moves & -moves, sym) == BIT_ULL(book[slot].move)) {
+				return __ffs64(moves);
+			}
+		}
+		return -1;
+	}
+	return -1;
+}
+
+/*
+* take in the contents of an opening book file,
+* check it and publish it as openingBook for probeBook.
+* return number of positions, -EINVAL when malformed or -ENOMEM
+*
+* The file is little endian: "RVBK", u32 version 1, u32 record count,
+* u32 reserved, then 17 byte records sorted by own then opp discs:
+* u64 own discs, u64 opponent discs, u8 move (row * 8 + col).
+* Positions are from the mover's side and canonical.
+*/
+int parseOpeningBook(const u8 * data, size_t size) {
+	struct book_entry * book;
+	const u8 * rec;
+	u64 own, opp, prevOwn, prevOpp, canonOwn, canonOpp;
+	u32 count, i, slot, mask;
+	unsigned int bits;
+
+	if (size < BOOK_HEADER_LEN || get_unaligned_le32(data) != BOOK_MAGIC ||
+			get_unaligned_le32(data + 4) != BOOK_VERSION) {
+		return -EINVAL;
+	}
+	count = get_unaligned_le32(data + 8);
+	if (count == 0 || count > BOOK_MAX_ENTRIES ||
+			size != BOOK_HEADER_LEN + (size_t)count * BOOK_RECORD_LEN) {
+		return -EINVAL;
+	}
+
+	/*at most half full keeps probes short*/
+	bits = ilog2(roundup_pow_of_two(count)) + 1;
+	mask = (1U << bits) - 1;
+	book = vzalloc(sizeof(*book) << bits);
+	if (book == NULL) {
+		return -ENOMEM;
+	}
+	prevOwn = 0;
+	prevOpp = 0;
+	rec = data + BOOK_HEADER_LEN;
+	for (i = 0; i < count; i++, rec += BOOK_RECORD_LEN) {
+		own = get_unaligned_le64(rec);
+		opp = get_unaligned_le64(rec + 8);
+		/*sorted without repeats, canonical so probeBook can find it, discs apart, move on an empty square*/
+		if ((i > 0 && (own < prevOwn || (own == prevOwn && opp <= prevOpp))) ||
+				(own & opp) || (own | opp) == 0 || rec[16] >= BOARDSIZE ||
+				((own | opp) & BIT_ULL(rec[16])) ||
+				canonicalPosition(own, opp, &canonOwn, &canonOpp) != 0) {
+			vfree(book);
+			return -EINVAL;
+		}
+		prevOwn = own;
+		prevOpp = opp;
+		for (slot = bookSlot(own, opp, bits); book[slot].own | book[slot].opp; slot = (slot + 1) & mask) {
+		}
+		book[slot].own = own;
+		book[slot].opp = opp;
+		book[slot].move = rec[16];
+	}
+
+	/*searches may already be probing, bookBits must land first*/
+	bookBits = bits;
+	smp_store_release(&openingBook, book);
+	return count;
+}
+
+/*
+* pattern evaluation
+*/
+
+/*
+* take in nothing, after initZobrist,
+* lay every symmetric instance of PATTERNS onto the board and fill
+* squareRefs and instanceTable. Tables follow each other in PATTERNS
+* order after the two mobility weights.
+*/
+void initPatterns(void) {
+	int p, sym, i, sq, instance;
+	u32 table, size;
+	u16 pow3;
+
+	/*safe to run again, the KUnit suite does before every case*/
+	memset(squareRefCount, 0, sizeof(squareRefCount));
+	instance = 0;
+	table = 2;
+	for (p = 0; p < ARRAY_SIZE(PATTERNS); p++) {
+		for (size = 1, i = 0; i < PATTERNS[p].len; i++) {
+			size *= 3;
+		}
+		for (sym = 0; sym < 8; sym++) {
+			if (!(PATTERNS[p].syms & BIT(sym))) {
+				continue;
+			}
+			pow3 = 1;
+			for (i = 0; i < PATTERNS[p].len; i++, pow3 *= 3) {
+				sq = __ffs64(transformBoard(BIT_ULL(PATTERNS[p].squares[i]), sym));
+				squareRefs[sq][squareRefCount[sq]].instance = instance;
+				squareRefs[sq][squareRefCount[sq]].pow3 = pow3;
+				squareRefCount[sq]++;
+			}
+			instanceTable[instance++] = table;
+		}
+		table += size;
+	}
+	evalWeightsLen = table;
+}
+
+/*
+* take in board with its discs set,
+* work out every pattern index from scratch
+*/
+void computePatterns(struct reversi_board * board) {
+	int i, sq, player;
+	u64 tokens;
+
+	memset(board->patterns, 0, sizeof(board->patterns));
+	for (player = PLAYER_BLACK; player <= PLAYER_WHITE; player++) {
+		for (tokens = board->discs[player]; tokens; tokens &= tokens - 1) {
+			sq = __ffs64(tokens);
+			for (i = 0; i < squareRefCount[sq]; i++) {
+				board->patterns[squareRefs[sq][i].instance] += (player + 1) * squareRefs[sq][i].pow3;
+			}
+		}
+	}
+}
+
+/*
+* take in the contents of an evaluation weights file,
+* check it and publish it as evalWeights for evaluateBoard.
+* Until then evaluateBoard falls back to square weights and mobility.
+* return 0, -EINVAL when malformed or -ENOMEM
+*
+* The file is little endian: "RVEV", u32 version 1, two reserved u32,
+* then s16 weights from black's side: mobility per move of difference,
+* potential mobility per square of difference, then one table per
+* PATTERNS entry in order, 3^len weights each, indexed as the patterns
+* read the board.
+*/
+int parseEvalWeights(const u8 * data, size_t size) {
+	s16 * weights;
+	u32 i;
+
+	if (size != EVAL_HEADER_LEN + (size_t)evalWeightsLen * sizeof(s16) ||
+			get_unaligned_le32(data) != EVAL_MAGIC ||
+			get_unaligned_le32(data + 4) != EVAL_VERSION) {
+		return -EINVAL;
+	}
+	weights = vmalloc(evalWeightsLen * sizeof(s16));
+	if (weights == NULL) {
+		return -ENOMEM;
+	}
+	for (i = 0; i < evalWeightsLen; i++) {
+		weights[i] = (s16)get_unaligned_le16(data + EVAL_HEADER_LEN + 2 * i);
+	}
+
+	/*searches may already be running*/
+	smp_store_release(&evalWeights, weights);
+	return 0;
+}
+
+/*
+* take in player, board, both sides' mobility and the loaded weights,
+* sum the pattern tables plus mobility and potential mobility terms
+* return score from player's side
+*/
+static int patternScore(int player, const struct reversi_board * board, int ownMoves, int oppMoves,
+		const s16 * weights) {
+	int i, score, ownPotential, oppPotential;
+
+	score = 0;
+	for (i = 0; i < PATTERN_INSTANCES; i++) {
+		score += weights[instanceTable[i] + board->patterns[i]];
+	}
+	if (player == PLAYER_WHITE) {
+		score = -score;
+	}
+
+	/*empty squares next to the other side's discs are moves in the making*/
+	ownPotential = hweight64(board->frontier[OPPONENT(player)]);
+	oppPotential = hweight64(board->frontier[player]);
+	score += weights[0] * (ownMoves - oppMoves) + weights[1] * (ownPotential - oppPotential);
+	return score;
+}
+
+/*
+* take in player and a finished board
+* return disc margin scaled past any evaluation, from player's side
+*/
+static int finalScore(int player, const struct reversi_board * board) {
+	return figureWhoWon(player, board) * SCORE_DISC;
+}
+
+/*
+* take in player and board.
+* sum the pattern tables when weights are loaded, else weigh squares
+* held and mobility.
+* return score from player's side, positive is good for player
+*/
+int evaluateBoard(int player, const struct reversi_board * board) {
+	int i, score, ownMoves, oppMoves;
+	const s16 * weights;
+	u64 own, opp;
+	own = board->discs[player];
+	opp = board->discs[OPPONENT(player)];
+
+	ownMoves = hweight64(board->moves[player]);
+	oppMoves = hweight64(board->moves[OPPONENT(player)]);
+	if (ownMoves == 0 && oppMoves == 0) {
+		return finalScore(player, board);
+	}
+
+	weights = smp_load_acquire(&evalWeights);
+	if (weights != NULL) {
+		score = patternScore(player, board, ownMoves, oppMoves, weights);
+		return clamp(score, -(SCORE_DISC - 1), SCORE_DISC - 1);
+	}
+
+	score = 0;
+	for (i = 0; i < BOARDSIZE; i++) {
+		if (own & BIT_ULL(i)) {
+			score += SQUARE_WEIGHTS[i];
+		} else if (opp & BIT_ULL(i)) {
+			score -= SQUARE_WEIGHTS[i];
+		}
+	}
+	score += 10 * (ownMoves - oppMoves);
+	return clamp(score, -(SCORE_DISC - 1), SCORE_DISC - 1);
+}
+
+/*
+* take in search, board, player to move, plies left and the alpha-beta window.
+* passed is set when the opponent just had to pass.
+* return score from player's side, 0 once the search has stopped
+*/
+int negamax(struct reversi_search * search, const struct reversi_board * board, int player,
+		int depth, int alpha, int beta, int passed) {
+	struct reversi_board child;
+	u64 moves, tier, key, entry;
+	int i, move, score, best, bestMove, alphaOrig, ttMove;
+
+	if ((++search->nodes & (SEARCH_CHECK_NODES - 1)) == 0) {
+		checkSearchBudget(search);
+	}
+	if (search->stopped) {
+		return 0;
+	}
+	if (depth <= 0) {
+		return evaluateBoard(player, board);
+	}
+
+	moves = tallyLegalMoves(player, board);
+	if (!moves) {
+		/*two passes in a row ends the game*/
+		if (passed) {
+			return finalScore(player, board);
+		}
+		return -negamax(search, board, OPPONENT(player), depth, -beta, -alpha, 1);
+	}
+
+	/*reuse what any session already learned about this position*/
+	key = positionKey(board, player);
+	entry = probeTable(key);
+	ttMove = -1;
+	if (entry) {
+		score = (s32)(u32)entry;
+		if ((int)((entry >> 40) & 0xff) >= depth) {
+			switch ((entry >> 48) & 0xff) {
+			case TT_EXACT:
+				return score;
+			case TT_LOWER:
+				if (score >= beta) {
+					return score;
+				}
+				break;
+			case TT_UPPER:
+				if (score <= alpha) {
+					return score;
+				}
+				break;
+			}
+		}
+		ttMove = (entry >> 32) & 0xff;
+		if (!(moves & BIT_ULL(ttMove))) {
+			ttMove = -1;
+		}
+	}
+
+	alphaOrig = alpha;
+	best = -SCORE_INF;
+	bestMove = -1;
+	/*stored best move first, then the remaining moves by tier*/
+	for (i = -1; i < (int)ARRAY_SIZE(MOVE_ORDER); i++) {
+		if (i < 0) {
+			tier = (ttMove >= 0) ? BIT_ULL(ttMove) : 0;
+		} else if (ttMove >= 0) {
+			tier = moves & MOVE_ORDER[i] & ~BIT_ULL(ttMove);
+		} else {
+			tier = moves & MOVE_ORDER[i];
+		}
+		for (; tier; tier &= tier - 1) {
+			move = __ffs64(tier);
+			child = *board;
+			makeYourMove(move, player, &child);
+			score = -negamax(search, &child, OPPONENT(player), depth - 1, -beta, -alpha, 0);
+			if (search->stopped) {
+				return 0;
+			}
+			if (score > best) {
+				best = score;
+				bestMove = move;
+				if (score > alpha) {
+					alpha = score;
+					if (alpha >= beta) {
+						storeTable(key, best, bestMove, depth, TT_LOWER);
+						return best;
+					}
+				}
+			}
+		}
+	}
+	storeTable(key, best, bestMove, depth, best > alphaOrig ? TT_EXACT : TT_UPPER);
+	return best;
+}
+
+/*
+* exact endgame solver, scores are final disc margins from the mover's side.
+* Works on bare disc masks, no hash, no table, nothing allocated.
+*/
+
+/*
+* take in the mover's and opponent's discs and the mover's legal moves,
+* list the moves by how few replies each leaves the opponent
+* return number of moves in list
+*/
+static int orderFastestFirst(u64 own, u64 opp, u64 moves, u8 * list)
+{
+	int n, i, move, count;
+	u8 replies[BOARDSIZE];
+	u64 flips;
+
+	for (n = 0; moves; moves &= moves - 1, n++) {
+		move = __ffs64(moves);
+		flips = findFlips(move, own, opp);
+		count = hweight64(findLegalMoves(opp & ~flips, own | flips | BIT_ULL(move)));
+		/*insertion sort, lists are short*/
+		for (i = n; i > 0 && replies[i - 1] > count; i--) {
+			list[i] = list[i - 1];
+			replies[i] = replies[i - 1];
+		}
+		list[i] = move;
+		replies[i] = count;
+	}
+	return n;
+}
+
+/*
+* take in the discs and the empty square of a board one move from full,
+* return final margin for own after the last move, or after passing it over
+*/
+static int solveLastEmpty(u64 own, u64 opp, int square)
+{
+	u64 flips;
+
+	flips = findFlips(square, own, opp);
+	if (flips) {
+		return hweight64(own | flips) + 1 - hweight64(opp & ~flips);
+	}
+	flips = findFlips(square, opp, own);
+	if (flips) {
+		return hweight64(own & ~flips) - hweight64(opp | flips) - 1;
+	}
+	return hweight64(own) - hweight64(opp);
+}
+
+/*
+* take in search, the mover's and opponent's discs and the alpha-beta window.
+* passed is set when the opponent just had to pass.
+* Moves are sorted fastest first while many squares are empty, after that
+* moves into quadrants with an odd number of empties go first, so the
+* mover tends to get the last move of each region.
+* return exact final margin from own's side, 0 once the search has stopped
+*/
+int solveEndgame(struct reversi_search * search, u64 own, u64 opp, int alpha, int beta, int passed)
+{
+	u64 moves, empty, odd, tier, flips;
+	int i, n, move, score, best;
+	u8 list[BOARDSIZE]; /* a byte a square, this frame repeats once per empty */
+
+	if ((++search->nodes & (SEARCH_CHECK_NODES - 1)) == 0) {
+		checkSearchBudget(search);
+	}
+	if (search->stopped) {
+		return 0;
+	}
+	empty = ~(own | opp);
+	if (hweight64(empty) == 1) {
+		return solveLastEmpty(own, opp, __ffs64(empty));
+	}
+
+	moves = findLegalMoves(own, opp);
+	if (!moves) {
+		/*two passes in a row ends the game*/
+		if (passed) {
+			return hweight64(own) - hweight64(opp);
+		}
+		return -solveEndgame(search, opp, own, -beta, -alpha, 1);
+	}
+
+	best = -SCORE_INF;
+	if (hweight64(empty) > ENDGAME_SORT_EMPTIES) {
+		n = orderFastestFirst(own, opp, moves, list);
+		for (i = 0; i < n; i++) {
+			move = list[i];
+			flips = findFlips(move, own, opp);
+			score = -solveEndgame(search, opp & ~flips, own | flips | BIT_ULL(move), -beta, -alpha, 0);
+			if (search->stopped) {
+				return 0;
+			}
+			if (score > best) {
+				best = score;
+				if (score > alpha) {
+					alpha = score;
+					if (alpha >= beta) {
+						return best;
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	odd = 0;
+	if (hweight64(empty & QUADRANT_A1) & 1) {
+		odd |= QUADRANT_A1;
+	}
+	if (hweight64(empty & QUADRANT_H1) & 1) {
+		odd |= QUADRANT_H1;
+	}
+	if (hweight64(empty & QUADRANT_A8) & 1) {
+		odd |= QUADRANT_A8;
+	}
+	if (hweight64(empty & QUADRANT_H8) & 1) {
+		odd |= QUADRANT_H8;
+	}
+	/*odd quadrants first, then the rest*/
+	for (i = 0; i < 2; i++) {
+		tier = moves & (i ? ~odd : odd);
+		for (; tier; tier &= tier - 1) {
+			move = __ffs64(tier);
+			flips = findFlips(move, own, opp);
+			score = -solveEndgame(search, opp & ~flips, own | flips | BIT_ULL(move), -beta, -alpha, 0);
+			if (search->stopped) {
+				return 0;
+			}
+			if (score > best) {
+				best = score;
+				if (score > alpha) {
+					alpha = score;
+					if (alpha >= beta) {
+						return best;
+					}
+				}
+			}
+		}
+	}
+	return best;
+}
+
+/*
+* take in search from initSearch, board, and player with at least one legal move.
+* solve every move exactly, fastest first.
+* return best move, or when the budget runs out the best one fully solved,
+* else the first in order
+*/
+int solveBestMove(struct reversi_search * search, const struct reversi_board * board, int player)
+{
+	u64 own, opp, flips;
+	int i, n, move, score, alpha;
+	u8 list[BOARDSIZE];
+
+	own = board->discs[player];
+	opp = board->discs[OPPONENT(player)];
+	n = orderFastestFirst(own, opp, tallyLegalMoves(player, board), list);
+	search->bestMove = list[0];
+
+	alpha = -BOARDSIZE - 1;
+	for (i = 0; i < n; i++) {
+		move = list[i];
+		flips = findFlips(move, own, opp);
+		score = -solveEndgame(search, opp & ~flips, own | flips | BIT_ULL(move), -BOARDSIZE - 1, -alpha, 0);
+		if (search->stopped) {
+			return search->bestMove;
+		}
+		if (score > alpha) {
+			alpha = score;
+			search->bestMove = move;
+			search->score = score * SCORE_DISC;
+		}
+	}
+	search->depth = BOARDSIZE - hweight64(own | opp);
+	return search->bestMove;
+}
+
+/*
+* take in search, board, player with at least two legal moves and first depth.
+* deepen one ply at a time until the budget runs out or the game is solved,
+* searching the previous best move first.
+* return best move of the deepest iteration, or of a partial one that beat it.
+*/
+int deepenSearch(struct reversi_search * search, const struct reversi_board * board, int player,
+		unsigned int firstDepth) {
+	struct reversi_board child;
+	u64 moves, rest;
+	int move, score, alpha, iterBest, empties;
+	unsigned int depth;
+
+	moves = tallyLegalMoves(player, board);
+	/*a search resumed past firstDepth 1 tries the best so far first*/
+	if (search->bestMove < 0 || !(moves & BIT_ULL(search->bestMove))) {
+		search->bestMove = __ffs64(moves);
+	}
+	empties = BOARDSIZE - hweight64(board->discs[PLAYER_BLACK] | board->discs[PLAYER_WHITE]);
+
+	for (depth = firstDepth; depth <= search->maxDepth; depth++) {
+		alpha = -SCORE_INF;
+		iterBest = -1;
+		move = search->bestMove;
+		rest = moves & ~BIT_ULL(move);
+		for (;;) {
+			child = *board;
+			makeYourMove(move, player, &child);
+			score = -negamax(search, &child, OPPONENT(player), depth - 1, -SCORE_INF, -alpha, 0);
+			if (search->stopped) {
+				break;
+			}
+			if (score > alpha) {
+				alpha = score;
+				iterBest = move;
+			}
+			if (!rest) {
+				break;
+			}
+			move = __ffs64(rest);
+			rest &= rest - 1;
+		}
+
+		if (search->stopped) {
+			/*previous best went first, anything that beat it here is better still*/
+			if (iterBest >= 0) {
+				search->bestMove = iterBest;
+				search->score = alpha;
+			}
+			break;
+		}
+		search->bestMove = iterBest;
+		search->score = alpha;
+		search->depth = depth;
+		if (depth >= empties) {
+			/*searched to the end of the game, deeper changes nothing*/
+			break;
+		}
+	}
+	return search->bestMove;
+}
+
+/*
+* take in nothing, once nothing searches any more,
+* free the transposition table, opening book and evaluation weights
+*/
+void freeEngineTables(void) {
+	vfree(transTable);
+	transTable = NULL;
+	vfree(openingBook);
+	openingBook = NULL;
+	vfree(evalWeights);
+	evalWeights = NULL;
+}
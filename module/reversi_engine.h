@@ -0,0 +1,139 @@
+/* file: reversi_engine.h
+* description: The reversi engine, board, move generation, evaluation and
+*	search, with no ties to the character device. reversi_engine.c builds
+*	into reversi.ko and, through reversi_user.h, into libreversi.a for
+*	benchmarks and tools in user space.
+*/
+
+#ifndef REVERSI_ENGINE_H
+#define REVERSI_ENGINE_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/ktime.h>
+#else
+#include "reversi_user.h"
+#endif
+#include "reversi_ioctl.h"	/* colours */
+
+#define BLACK "X"
+#define WHITE "O"
+#define EMPTY "-"
+#define BOARDSIZE 64
+#define BOARD_DIM 8
+#define BOARD_LEN 67	/* 64 squares, tab, next player, newline */
+#define TOKENS "XO"	/* indexed by player */
+#define PLAYER_BLACK REVERSI_BLACK
+#define PLAYER_WHITE REVERSI_WHITE
+#define NO_PLAYER (-1)
+#define OPPONENT(player) ((player) ^ 1)
+/* bit (row * 8 + col) of a bitboard is set when the square holds a token */
+#define SQUARE(col, row) ((row) * BOARD_DIM + (col))
+#define FILE_A 0x0101010101010101ULL
+#define FILE_H 0x8080808080808080ULL
+#define CORNERS 0x8100000000000081ULL
+/* squares diagonally or orthogonally next to a corner */
+#define CORNER_NEIGHBOURS 0x42C300000000C342ULL
+/* the four 4x4 quadrants, endgame parity is counted per quadrant */
+#define QUADRANT_A1 0x000000000F0F0F0FULL
+#define QUADRANT_H1 0x00000000F0F0F0F0ULL
+#define QUADRANT_A8 0x0F0F0F0F00000000ULL
+#define QUADRANT_H8 0xF0F0F0F000000000ULL
+#define SCORE_INF 1000000
+#define SCORE_DISC 10000	/* finished game, per disc of margin, beats any evaluation */
+#define SEARCH_CHECK_NODES 1024	/* nodes between budget checks, power of two */
+#define ENDGAME_SORT_EMPTIES 7	/* above this many empties the solver sorts moves fastest first */
+#define PERFT_RESCHED_DEPTH 4	/* perft subtrees this deep yield the CPU first */
+#define ZOBRIST_SEED 0x5245564552534921ULL
+/* opening book file, see parseOpeningBook */
+#define BOOK_MAGIC 0x4B425652	/* "RVBK" */
+#define BOOK_VERSION 1
+#define BOOK_HEADER_LEN 16
+#define BOOK_RECORD_LEN 17
+#define BOOK_MAX_ENTRIES (1 << 20)
+/* pattern evaluation, see initPatterns and parseEvalWeights */
+#define PATTERN_MAX_LEN 10
+#define PATTERN_INSTANCES 34
+#define PATTERN_REFS_MAX 8	/* instances any one square can be part of */
+#define EVAL_MAGIC 0x56455652	/* "RVEV" */
+#define EVAL_VERSION 1
+#define EVAL_HEADER_LEN 16
+/* transposition table bounds */
+#define TT_EXACT 1
+#define TT_LOWER 2 /* score is at least the stored one, from a beta cutoff */
+#define TT_UPPER 3 /* score is at most the stored one, nothing beat alpha */
+
+/*
+* one 64 bit word per colour, indexed by PLAYER_BLACK / PLAYER_WHITE
+*/
+struct reversi_board {
+	u64 discs[2];
+	u64 hash; /* zobrist hash of discs, kept up to date by flipTokens */
+	/* also kept up to date by loadBoard and flipTokens, callers never rescan */
+	u64 moves[2]; /* legal moves of each colour */
+	u64 frontier[2]; /* empty squares next to at least one disc of each colour, potential mobility */
+	u8 count[2]; /* discs of each colour */
+	u16 patterns[PATTERN_INSTANCES]; /* base 3 index of each pattern instance */
+};
+
+/*
+* budget and outcome of one computer move search
+*/
+struct reversi_search {
+	ktime_t deadline; /* only checked when useDeadline is set */
+	int useDeadline;
+	u64 nodeLimit; /* 0 for no node budget */
+	unsigned int maxDepth;
+	u64 nodes;
+	int stopped; /* budget ran out, partial results are discarded */
+	int bestMove;
+	int score; /* of bestMove, from the mover's side */
+	int depth; /* deepest completed iteration */
+	const int * stopAll; /* helpers only, set by the main search when it is done */
+	/* time slicing, ignored while waiting is NULL */
+	const unsigned int * waiting; /* others waiting for the CPU, nonzero past sliceEnd stops the search */
+	ktime_t sliceEnd;
+	int yielded; /* stopped for others waiting rather than for the budget */
+};
+
+/*Othello*/
+void initZobrist(void);
+void initPatterns(void);
+void computePatterns(struct reversi_board * board);
+u64 hashBoard(const struct reversi_board * board);
+void setupBoard(struct reversi_board * board);
+void loadBoard(struct reversi_board * board, u64 black, u64 white);
+u64 findLegalMoves(u64 own, u64 opp);
+u64 findNeighbours(u64 tokens);
+u64 findFlips(int move, u64 own, u64 opp);
+int countToken(int player, const struct reversi_board * board);
+int checkForLegal(int move, int player, const struct reversi_board * board);
+void flipTokens(int move, int player, struct reversi_board * board, u64 flips);
+void makeYourMove(int move, int player, struct reversi_board * board);
+u64 tallyLegalMoves(int player, const struct reversi_board * board);
+int lookForLegalMove(int player, const struct reversi_board * board);
+int checkNextPlayer(const struct reversi_board * board, int prevPlayer);
+int figureWhoWon(int player, const struct reversi_board * board);
+void renderBoard(const struct reversi_board * board, int nextPlayer, char * out);
+u64 perft(struct reversi_search * search, const struct reversi_board * board, int player, unsigned int depth,
+		int passed);
+
+/*Search*/
+void initSearch(struct reversi_search * search, unsigned int timeMs, u64 nodeLimit, unsigned int maxDepth);
+int searchBudgetSpent(const struct reversi_search * search);
+int evaluateBoard(int player, const struct reversi_board * board);
+int negamax(struct reversi_search * search, const struct reversi_board * board, int player,
+		int depth, int alpha, int beta, int passed);
+int solveEndgame(struct reversi_search * search, u64 own, u64 opp, int alpha, int beta, int passed);
+int solveBestMove(struct reversi_search * search, const struct reversi_board * board, int player);
+int deepenSearch(struct reversi_search * search, const struct reversi_board * board, int player,
+		unsigned int firstDepth);
+
+/*Tables, shared by every caller*/
+int initTransTable(unsigned int sizeMb);
+int probeBook(const struct reversi_board * board, int player);
+int parseOpeningBook(const u8 * data, size_t size);
+int parseEvalWeights(const u8 * data, size_t size);
+void freeEngineTables(void);
+
+#endif /* REVERSI_ENGINE_H */
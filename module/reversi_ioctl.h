@@ -0,0 +1,146 @@
+/* file: reversi_ioctl.h
+* description: Binary ioctl interface to /dev/reversi, shared by the driver
+*	and user space. Every call takes and returns one struct reversi_ioc_game,
+*	so a command and the board it leaves behind cost a single syscall.
+*	The mmap page layout lives here too, along with the calls that let
+*	read only spectators follow someone else's game, the calls that
+*	run many games over one file and the batch evaluation call.
+*/
+
+#ifndef REVERSI_IOCTL_H
+#define REVERSI_IOCTL_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* colours, bit (row * 8 + col) of black/white is set when that colour holds the square */
+#define REVERSI_BLACK	0
+#define REVERSI_WHITE	1
+#define REVERSI_NONE	0xff	/* nextPlayer once neither side can move */
+
+/* result codes, same meaning as the text responses of the same name */
+#define REVERSI_OK	0
+#define REVERSI_WIN	1
+#define REVERSI_TIE	2
+#define REVERSI_LOSE	3
+#define REVERSI_NOGAME	4
+#define REVERSI_ILLMOVE	5
+#define REVERSI_OOT	6
+
+/*
+* search classes for REVERSI_IOC_SET_QOS. Searches of every session
+* share a fixed number of slots, interactive ones served first and
+* bulk ones still getting a small share under load.
+*/
+#define REVERSI_QOS_INTERACTIVE	0	/* needs CAP_SYS_NICE */
+#define REVERSI_QOS_NORMAL	1	/* the default */
+#define REVERSI_QOS_BULK	2
+
+struct reversi_ioc_game {
+	__u64 black;		/* out: X discs */
+	__u64 white;		/* out: O discs */
+	__s32 result;		/* out: REVERSI_OK ... REVERSI_OOT */
+	__u8 human;		/* in for NEW_GAME, out otherwise: colour the human plays */
+	__u8 nextPlayer;	/* out: colour to move, or REVERSI_NONE */
+	__u8 col;		/* in for HUMAN_MOVE, out for COMPUTER_MOVE: square played */
+	__u8 row;
+};
+
+/*
+* layout of the read only page mmap() of /dev/reversi maps at offset 0,
+* kept current by the driver after every command on the session.
+* seq is odd while the driver rewrites the page: read seq, copy the
+* fields, read seq again, and retry if it was odd or changed.
+*/
+struct reversi_mmap_board {
+	__u32 seq;
+	__u8 inGame;		/* 0 until a game is dealt and again once it is decided */
+	__u8 human;		/* colour the human plays */
+	__u8 nextPlayer;	/* colour to move, or REVERSI_NONE */
+	__u8 pad;
+	__u64 black;		/* X discs */
+	__u64 white;		/* O discs */
+	__u32 blackCount;
+	__u32 whiteCount;
+};
+
+/*
+* one single game command on a game the file created, or on the
+* file's own game when id is 0. cmd is REVERSI_IOC_NEW_GAME through
+* REVERSI_IOC_PASS, or REVERSI_IOC_GAME_ID which puts the spectator
+* ID of that game in game.result.
+*/
+struct reversi_ioc_multi {
+	__u32 id;		/* in: ID from REVERSI_IOC_CREATE, 0 for the file's own game */
+	__u32 cmd;		/* in: single game ioctl to run */
+	struct reversi_ioc_game game;	/* in and out as for cmd */
+};
+
+/*
+* one position for REVERSI_IOC_EVALUATE, 32 bytes so a page holds 128.
+* score is from player's side in the engine's units, a decided game
+* scoring 10000 per disc of margin.
+*/
+struct reversi_ioc_position {
+	__u64 black;		/* in: X discs */
+	__u64 white;		/* in: O discs, none shared with black */
+	__u64 moves;		/* out: legal moves of player */
+	__s32 score;		/* out */
+	__u8 player;		/* in: colour to move */
+	__u8 bestMove;		/* out: square (row * 8 + col), REVERSI_NONE when moves is 0 */
+	__u8 pad[2];
+};
+
+struct reversi_ioc_batch {
+	__u64 positions;	/* in: user pointer to count struct reversi_ioc_position */
+	__u32 count;		/* in */
+	__u32 depth;		/* in: plies searched, 1 to REVERSI_EVAL_MAX_DEPTH */
+	__u32 done;		/* out: positions evaluated, in order from the first */
+	__u32 pad;
+};
+
+#define REVERSI_EVAL_MAX_DEPTH	10
+
+#define REVERSI_IOC_MAGIC	'R'
+/* "00 X" / "00 O" */
+#define REVERSI_IOC_NEW_GAME		_IOWR(REVERSI_IOC_MAGIC, 0, struct reversi_ioc_game)
+/* "01" */
+#define REVERSI_IOC_GET_BOARD		_IOWR(REVERSI_IOC_MAGIC, 1, struct reversi_ioc_game)
+/* "02 col row" */
+#define REVERSI_IOC_HUMAN_MOVE		_IOWR(REVERSI_IOC_MAGIC, 2, struct reversi_ioc_game)
+/* "03" */
+#define REVERSI_IOC_COMPUTER_MOVE	_IOWR(REVERSI_IOC_MAGIC, 3, struct reversi_ioc_game)
+/* "04" */
+#define REVERSI_IOC_PASS		_IOWR(REVERSI_IOC_MAGIC, 4, struct reversi_ioc_game)
+/*
+* ID spectators on the same node watch this session's game by, handed
+* out on the first call and kept until the session is closed
+*/
+#define REVERSI_IOC_GAME_ID		_IOR(REVERSI_IOC_MAGIC, 5, __u32)
+/*
+* turn an fd opened O_RDONLY into a spectator of the game with this ID.
+* From then on read() returns the board each time it changes (NOGAME
+* before one is dealt) and EOF once the player closes, poll() waits for
+* a change, and GET_BOARD is the only ioctl that works.
+*/
+#define REVERSI_IOC_WATCH		_IOW(REVERSI_IOC_MAGIC, 6, __u32)
+/*
+* add a game to this file and return its ID, so one file can run many
+* games without an open() each. Up to the max_games module parameter.
+*/
+#define REVERSI_IOC_CREATE		_IOR(REVERSI_IOC_MAGIC, 7, __u32)
+/* remove a game REVERSI_IOC_CREATE added, closing the file removes the rest */
+#define REVERSI_IOC_DESTROY		_IOW(REVERSI_IOC_MAGIC, 8, __u32)
+/* see struct reversi_ioc_multi, games of one file can be played from many threads at once */
+#define REVERSI_IOC_GAME		_IOWR(REVERSI_IOC_MAGIC, 9, struct reversi_ioc_multi)
+/* REVERSI_QOS_* of this file's game and of the games it creates from then on */
+#define REVERSI_IOC_SET_QOS		_IOW(REVERSI_IOC_MAGIC, 10, __u32)
+/*
+* evaluate a whole array of positions in one call, for analytics,
+* searching each depth plies under this file's REVERSI_QOS_* class.
+* Stops at a position that is not a legal board with EINVAL and on a
+* signal with EINTR, done saying how far it got either way.
+*/
+#define REVERSI_IOC_EVALUATE		_IOWR(REVERSI_IOC_MAGIC, 11, struct reversi_ioc_batch)
+
+#endif /* REVERSI_IOCTL_H */
@@ -0,0 +1,148 @@
+/* file: reversi_kunit.c
+* description: KUnit suite for the kernel build of the reversi engine.
+*	Checks perft from the starting position against the known counts,
+*	the time budget that bounds "05" and when it yields, loadBoard against boards
+*	reached by play, and that no two pattern instances share their
+*	squares. Built as reversi_kunit.ko with
+*	make CONFIG_REVERSI_KUNIT_TEST=m on a kernel with CONFIG_KUNIT,
+*	loading it runs the suite and reports under the usual KTAP output.
+*/
+
+#include <kunit/test.h>
+#include <linux/module.h>
+/* the engine is compiled into this module too, so reversi.ko need not export it */
+#include "reversi_engine.c"
+
+#define PERFT_TEST_DEPTH 8	/* under half a million positions, quick enough for every boot */
+
+/* positions after n plies from the start, a forced pass counting as a ply */
+static const u64 PERFT_COUNTS[PERFT_TEST_DEPTH + 1] = {
+	1ULL, 4ULL, 12ULL, 56ULL, 244ULL, 1396ULL, 8200ULL, 55092ULL, 390216ULL
+};
+
+static int reversiEngineTestInit(struct kunit *test)
+{
+	initZobrist();
+	initPatterns();
+	return 0;
+}
+
+static void perftStartCountsTest(struct kunit *test)
+{
+	struct reversi_board board;
+	unsigned int depth;
+
+	setupBoard(&board);
+	for (depth = 0; depth <= PERFT_TEST_DEPTH; depth++) {
+		KUNIT_EXPECT_EQ_MSG(test, perft(NULL, &board, PLAYER_BLACK, depth, 0), PERFT_COUNTS[depth],
+			"perft %u", depth);
+	}
+}
+
+static void perftBudgetTest(struct kunit *test)
+{
+	struct reversi_board board;
+	struct reversi_search search;
+	const unsigned int waiting = 1;
+	u64 leaves;
+
+	setupBoard(&board);
+	/*a budget that is not reached changes nothing*/
+	initSearch(&search, 60000, 0, 0);
+	leaves = perft(&search, &board, PLAYER_BLACK, 6, 0);
+	KUNIT_EXPECT_FALSE(test, search.stopped);
+	KUNIT_EXPECT_EQ(test, leaves, PERFT_COUNTS[6]);
+
+	/*one already spent stops at the first subtree deep enough to check it*/
+	initSearch(&search, 1, 0, 0);
+	search.deadline = ktime_get();
+	perft(&search, &board, PLAYER_BLACK, PERFT_TEST_DEPTH, 0);
+	KUNIT_EXPECT_TRUE(test, search.stopped);
+	KUNIT_EXPECT_FALSE(test, search.yielded);
+
+	/*others waiting past the slice end do not make a spent search yield*/
+	initSearch(&search, 1, 0, 0);
+	search.deadline = ktime_get();
+	search.waiting = &waiting;
+	search.sliceEnd = ktime_get();
+	perft(&search, &board, PLAYER_BLACK, PERFT_TEST_DEPTH, 0);
+	KUNIT_EXPECT_TRUE(test, search.stopped);
+	KUNIT_EXPECT_FALSE(test, search.yielded);
+
+	/*with budget left they do*/
+	initSearch(&search, 60000, 0, 0);
+	search.waiting = &waiting;
+	search.sliceEnd = ktime_get();
+	perft(&search, &board, PLAYER_BLACK, PERFT_TEST_DEPTH, 0);
+	KUNIT_EXPECT_TRUE(test, search.stopped);
+	KUNIT_EXPECT_TRUE(test, search.yielded);
+}
+
+static void loadBoardTest(struct kunit *test)
+{
+	struct reversi_board played, loaded;
+	int player = PLAYER_BLACK;
+	u64 moves;
+
+	setupBoard(&played);
+	/*first legal move each ply until the game ends*/
+	for (;;) {
+		moves = tallyLegalMoves(player, &played);
+		if (!moves) {
+			player = OPPONENT(player);
+			moves = tallyLegalMoves(player, &played);
+			if (!moves) {
+				break;
+			}
+		}
+		makeYourMove(__ffs64(moves), player, &played);
+		player = OPPONENT(player);
+		loadBoard(&loaded, played.discs[PLAYER_BLACK], played.discs[PLAYER_WHITE]);
+		/*field by field, padding may differ*/
+		KUNIT_ASSERT_EQ(test, loaded.hash, played.hash);
+		KUNIT_ASSERT_EQ(test, loaded.moves[PLAYER_BLACK], played.moves[PLAYER_BLACK]);
+		KUNIT_ASSERT_EQ(test, loaded.moves[PLAYER_WHITE], played.moves[PLAYER_WHITE]);
+		KUNIT_ASSERT_EQ(test, loaded.frontier[PLAYER_BLACK], played.frontier[PLAYER_BLACK]);
+		KUNIT_ASSERT_EQ(test, loaded.frontier[PLAYER_WHITE], played.frontier[PLAYER_WHITE]);
+		KUNIT_ASSERT_EQ(test, loaded.count[PLAYER_BLACK], played.count[PLAYER_BLACK]);
+		KUNIT_ASSERT_EQ(test, loaded.count[PLAYER_WHITE], played.count[PLAYER_WHITE]);
+		KUNIT_ASSERT_EQ(test, memcmp(loaded.patterns, played.patterns, sizeof(played.patterns)), 0);
+	}
+}
+
+static void patternInstancesTest(struct kunit *test)
+{
+	u64 squares[PATTERN_INSTANCES] = { 0 };
+	int sq, i, j;
+
+	for (sq = 0; sq < BOARDSIZE; sq++) {
+		KUNIT_ASSERT_LE(test, squareRefCount[sq], PATTERN_REFS_MAX);
+		for (i = 0; i < squareRefCount[sq]; i++) {
+			squares[squareRefs[sq][i].instance] |= BIT_ULL(sq);
+		}
+	}
+	/*two instances on the same squares would count that line twice*/
+	for (i = 0; i < PATTERN_INSTANCES; i++) {
+		for (j = 0; j < i; j++) {
+			KUNIT_EXPECT_NE_MSG(test, squares[i], squares[j], "instances %d and %d", j, i);
+		}
+	}
+}
+
+static struct kunit_case reversiEngineCases[] = {
+	KUNIT_CASE(perftStartCountsTest),
+	KUNIT_CASE(perftBudgetTest),
+	KUNIT_CASE(loadBoardTest),
+	KUNIT_CASE(patternInstancesTest),
+	{}
+};
+
+static struct kunit_suite reversiEngineSuite = {
+	.name = "reversi_engine",
+	.init = reversiEngineTestInit,
+	.test_cases = reversiEngineCases,
+};
+kunit_test_suite(reversiEngineSuite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("KUnit tests for the reversi engine");
@@ -0,0 +1,148 @@
+/* file: reversi_trace.h
+* description: Tracepoints for the session, command and search lifecycle of
+*	/dev/reversi, under events/reversi/ in tracefs and usable from perf.
+*	Every event carries the session pointer so one game can be followed
+*	across commands, searches and the workqueue.
+*/
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM reversi
+
+#if !defined(REVERSI_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define REVERSI_TRACE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(reversi_session_class,
+	TP_PROTO(const void *session, unsigned int minor, int sessions),
+	TP_ARGS(session, minor, sessions),
+	TP_STRUCT__entry(
+		__field(const void *, session)
+		__field(unsigned int, minor)
+		__field(int, sessions)
+	),
+	TP_fast_assign(
+		__entry->session = session;
+		__entry->minor = minor;
+		__entry->sessions = sessions;
+	),
+	TP_printk("session=%p minor=%u sessions=%d",
+		__entry->session, __entry->minor, __entry->sessions)
+);
+
+/* sessions counts the node's open sessions after the open or release */
+DEFINE_EVENT(reversi_session_class, reversi_session_open,
+	TP_PROTO(const void *session, unsigned int minor, int sessions),
+	TP_ARGS(session, minor, sessions)
+);
+
+DEFINE_EVENT(reversi_session_class, reversi_session_release,
+	TP_PROTO(const void *session, unsigned int minor, int sessions),
+	TP_ARGS(session, minor, sessions)
+);
+
+/* one text command line, newline stripped, before it is parsed */
+TRACE_EVENT(reversi_command,
+	TP_PROTO(const void *session, const char *cmd),
+	TP_ARGS(session, cmd),
+	TP_STRUCT__entry(
+		__field(const void *, session)
+		__string(cmd, cmd)
+	),
+	TP_fast_assign(
+		__entry->session = session;
+		__assign_str(cmd, cmd);
+	),
+	TP_printk("session=%p cmd=\"%s\"", __entry->session, __get_str(cmd))
+);
+
+/* a human move checked on the human's turn, text and ioctl alike */
+TRACE_EVENT(reversi_human_move,
+	TP_PROTO(const void *session, int col, int row, int legal),
+	TP_ARGS(session, col, row, legal),
+	TP_STRUCT__entry(
+		__field(const void *, session)
+		__field(int, col)
+		__field(int, row)
+		__field(int, legal)
+	),
+	TP_fast_assign(
+		__entry->session = session;
+		__entry->col = col;
+		__entry->row = row;
+		__entry->legal = legal;
+	),
+	TP_printk("session=%p col=%d row=%d legal=%d",
+		__entry->session, __entry->col, __entry->row, __entry->legal)
+);
+
+TRACE_EVENT(reversi_search_start,
+	TP_PROTO(const void *session, int player, int empties),
+	TP_ARGS(session, player, empties),
+	TP_STRUCT__entry(
+		__field(const void *, session)
+		__field(int, player)
+		__field(int, empties)
+	),
+	TP_fast_assign(
+		__entry->session = session;
+		__entry->player = player;
+		__entry->empties = empties;
+	),
+	TP_printk("session=%p player=%d empties=%d",
+		__entry->session, __entry->player, __entry->empties)
+);
+
+/* depth is the deepest completed iteration, score is from the mover's side */
+TRACE_EVENT(reversi_search_end,
+	TP_PROTO(const void *session, int move, int depth, u64 nodes, int score, u64 ns),
+	TP_ARGS(session, move, depth, nodes, score, ns),
+	TP_STRUCT__entry(
+		__field(const void *, session)
+		__field(int, move)
+		__field(int, depth)
+		__field(u64, nodes)
+		__field(int, score)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+		__entry->session = session;
+		__entry->move = move;
+		__entry->depth = depth;
+		__entry->nodes = nodes;
+		__entry->score = score;
+		__entry->ns = ns;
+	),
+	TP_printk("session=%p move=%d depth=%d nodes=%llu score=%d ns=%llu",
+		__entry->session, __entry->move, __entry->depth,
+		__entry->nodes, __entry->score, __entry->ns)
+);
+
+/* result is REVERSI_WIN, REVERSI_TIE or REVERSI_LOSE for the human */
+TRACE_EVENT(reversi_game_end,
+	TP_PROTO(const void *session, int result, int human, int computer),
+	TP_ARGS(session, result, human, computer),
+	TP_STRUCT__entry(
+		__field(const void *, session)
+		__field(int, result)
+		__field(int, human)
+		__field(int, computer)
+	),
+	TP_fast_assign(
+		__entry->session = session;
+		__entry->result = result;
+		__entry->human = human;
+		__entry->computer = computer;
+	),
+	TP_printk("session=%p result=%d human=%d computer=%d",
+		__entry->session, __entry->result, __entry->human, __entry->computer)
+);
+
+#endif /* REVERSI_TRACE_H */
+
+/* the module builds out of tree, so define_trace.h looks for this header beside reversi_dev.c */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE reversi_trace
+#include <trace/define_trace.h>
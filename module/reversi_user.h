@@ -0,0 +1,91 @@
+/* file: reversi_user.h
+* description: The few kernel types and helpers reversi_engine.c uses,
+*	mapped onto libc and compiler builtins so the engine builds in
+*	user space. Only included when __KERNEL__ is not defined.
+*/
+
+#ifndef REVERSI_USER_H
+#define REVERSI_USER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef s64 ktime_t;	/* ns */
+
+#define BIT(n) (1UL << (n))
+#define BIT_ULL(n) (1ULL << (n))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define clamp(v, lo, hi) min(max(v, lo), hi)
+
+/* one search per thread, the transposition table is shared without locks */
+#define READ_ONCE(x) (*(const volatile __typeof__(x) *)&(x))
+#define WRITE_ONCE(x, v) (*(volatile __typeof__(x) *)&(x) = (v))
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#define hweight64(x) __builtin_popcountll(x)
+#define __ffs64(x) __builtin_ctzll(x)
+#define swab64(x) __builtin_bswap64(x)
+#define ilog2(x) (63 - __builtin_clzll(x))
+
+static inline u64 roundup_pow_of_two(u64 n) {
+	return n <= 1 ? 1 : 1ULL << (64 - __builtin_clzll(n - 1));
+}
+
+static inline u64 rounddown_pow_of_two(u64 n) {
+	return 1ULL << ilog2(n);
+}
+
+/* same multiplier as the kernel, so book slots match */
+static inline u32 hash_64(u64 val, unsigned int bits) {
+	return (u32)((val * 0x61C8864680B583EBULL) >> (64 - bits));
+}
+
+static inline u16 get_unaligned_le16(const void *p) {
+	const u8 *b = p;
+	return b[0] | (u16)b[1] << 8;
+}
+
+static inline u32 get_unaligned_le32(const void *p) {
+	const u8 *b = p;
+	return get_unaligned_le16(b) | (u32)get_unaligned_le16(b + 2) << 16;
+}
+
+static inline u64 get_unaligned_le64(const void *p) {
+	const u8 *b = p;
+	return get_unaligned_le32(b) | (u64)get_unaligned_le32(b + 4) << 32;
+}
+
+#define vmalloc(n) malloc(n)
+#define vzalloc(n) calloc(1, n)
+#define vfree(p) free(p)
+#define cond_resched() do { } while (0)
+
+static inline ktime_t ktime_get(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ktime_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#define ktime_get_ns() ((u64)ktime_get())
+#define ktime_add_ms(t, ms) ((t) + (ktime_t)(ms) * 1000000)
+#define ktime_after(a, b) ((a) > (b))
+#define HZ 1000
+#define jiffies ((unsigned long)(ktime_get() / 1000000))
+
+#endif /* REVERSI_USER_H */
@@ -0,0 +1,371 @@
+/* file: reversi-bench.c
+* description: Load generator and latency benchmark for /dev/reversi.
+*	Opens sessions across several threads and plays whole games on each
+*	through the text protocol, the human side picking random legal moves
+*	from a seeded generator. Reports games/sec, commands/sec and
+*	p50/p99/p999 latency of every command type.
+*
+*	The same seed replays the same human moves. The computer's replies
+*	only repeat when the module is loaded with search_nodes set,
+*	search_time_ms=0, tt_size_mb=0, search_threads=1, search_slice_ms=0
+*	and ponder off. Otherwise the shared transposition table, filled by
+*	every session's searches in whatever order they run, or a search
+*	yielding its slot partway, changes them from run to run.
+*
+*	build: gcc -O2 -pthread -o reversi-bench reversi-bench.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#define RESP_MAX    1024
+#define BOARD_LEN   67
+#define BOARD_DIM   8
+#define NR_CMDS     5       /* "00" through "04" */
+#define MAX_PLIES   200     /* a real game ends well inside this */
+
+static const char *cmd_names[NR_CMDS] = { "00", "01", "02", "03", "04" };
+
+struct latencies {
+    uint64_t *ns;
+    size_t len;
+    size_t cap;
+};
+
+struct worker {
+    pthread_t thread;
+    int id;
+    uint64_t rng;
+    int failed;
+    unsigned long games;
+    unsigned long commands;
+    struct latencies lat[NR_CMDS];
+};
+
+static const char *device = "/dev/reversi";
+static int nr_threads = 4;
+static int nr_sessions = 1;     /* per thread */
+static int nr_games = 10;       /* per session */
+static uint64_t seed = 1;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift64*, seeded per thread so each thread's games are reproducible */
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+static int add_latency(struct latencies *l, uint64_t ns) {
+    uint64_t *grown;
+
+    if(l->len == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 1024;
+        if(!(grown = realloc(l->ns, l->cap * sizeof(*l->ns))))
+            return -1;
+        l->ns = grown;
+    }
+
+    l->ns[l->len++] = ns;
+    return 0;
+}
+
+/* Send one command and read its response, timing the round trip. */
+static int command(struct worker *w, int fd, int kind, const char *cmd,
+                   char *response) {
+    size_t len = strlen(cmd);
+    uint64_t start = now_ns();
+    ssize_t rlen;
+
+    if(write(fd, cmd, len) != (ssize_t)len) {
+        fprintf(stderr, "thread %d: write \"%.2s\": %s\n", w->id, cmd,
+                strerror(errno));
+        return -1;
+    }
+
+    if((rlen = read(fd, response, RESP_MAX - 1)) < 0) {
+        fprintf(stderr, "thread %d: read after \"%.2s\": %s\n", w->id, cmd,
+                strerror(errno));
+        return -1;
+    }
+
+    response[rlen] = 0;
+    w->commands++;
+    if(add_latency(&w->lat[kind], now_ns() - start)) {
+        fprintf(stderr, "thread %d: out of memory\n", w->id);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Does playing (col, row) for me flip anything on a board response? */
+static int is_legal(const char *bd, int col, int row, char me) {
+    static const int dirs[8][2] = {
+        { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+        { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 }
+    };
+    char them = me == 'X' ? 'O' : 'X';
+    int d, c, r, seen;
+
+    if(bd[row * BOARD_DIM + col] != '-')
+        return 0;
+
+    for(d = 0; d < 8; ++d) {
+        seen = 0;
+        c = col + dirs[d][0];
+        r = row + dirs[d][1];
+
+        while(c >= 0 && c < BOARD_DIM && r >= 0 && r < BOARD_DIM &&
+              bd[r * BOARD_DIM + c] == them) {
+            c += dirs[d][0];
+            r += dirs[d][1];
+            seen = 1;
+        }
+
+        if(seen && c >= 0 && c < BOARD_DIM && r >= 0 && r < BOARD_DIM &&
+           bd[r * BOARD_DIM + c] == me)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Play one game to the end, returns 0 once the device reports a result. */
+static int play_game(struct worker *w, int fd) {
+    char response[RESP_MAX], cmd[24];
+    int legal[BOARD_DIM * BOARD_DIM];
+    int ply, i, nr_legal;
+    char me = next_random(&w->rng) & 1 ? 'X' : 'O';
+
+    snprintf(cmd, sizeof(cmd), "00 %c\n", me);
+    if(command(w, fd, 0, cmd, response))
+        return -1;
+
+    if(strcmp(response, "OK\n")) {
+        fprintf(stderr, "thread %d: new game: %s", w->id, response);
+        return -1;
+    }
+
+    for(ply = 0; ply < MAX_PLIES; ++ply) {
+        if(command(w, fd, 1, "01\n", response))
+            return -1;
+
+        if(strlen(response) != BOARD_LEN || response[64] != '\t') {
+            fprintf(stderr, "thread %d: bad board: %s", w->id, response);
+            return -1;
+        }
+
+        if(response[65] != me) {
+            if(command(w, fd, 3, "03\n", response))
+                return -1;
+        }
+        else {
+            nr_legal = 0;
+            for(i = 0; i < BOARD_DIM * BOARD_DIM; ++i) {
+                if(is_legal(response, i % BOARD_DIM, i / BOARD_DIM, me))
+                    legal[nr_legal++] = i;
+            }
+
+            /* Once neither side can move, passing gets the result. */
+            if(!nr_legal) {
+                if(command(w, fd, 4, "04\n", response))
+                    return -1;
+            }
+            else {
+                i = legal[next_random(&w->rng) % nr_legal];
+                snprintf(cmd, sizeof(cmd), "02 %d %d\n", i % BOARD_DIM,
+                         i / BOARD_DIM);
+                if(command(w, fd, 2, cmd, response))
+                    return -1;
+            }
+        }
+
+        if(!strcmp(response, "WIN\n") || !strcmp(response, "TIE\n") ||
+           !strcmp(response, "LOSE\n")) {
+            w->games++;
+            return 0;
+        }
+
+        if(strcmp(response, "OK\n")) {
+            fprintf(stderr, "thread %d: unexpected response: %s", w->id,
+                    response);
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "thread %d: game did not end in %d plies\n", w->id,
+            MAX_PLIES);
+    return -1;
+}
+
+static void *run_worker(void *arg) {
+    struct worker *w = arg;
+    int *fds;
+    int s, g, opened;
+
+    if(!(fds = calloc(nr_sessions, sizeof(*fds)))) {
+        w->failed = 1;
+        return NULL;
+    }
+
+    for(opened = 0; opened < nr_sessions; ++opened) {
+        if((fds[opened] = open(device, O_RDWR)) < 0) {
+            fprintf(stderr, "thread %d: cannot open %s: %s\n", w->id, device,
+                    strerror(errno));
+            w->failed = 1;
+            goto out;
+        }
+    }
+
+    /* One game at a time, taking the sessions in turn. */
+    for(g = 0; g < nr_games && !w->failed; ++g) {
+        for(s = 0; s < nr_sessions && !w->failed; ++s) {
+            if(play_game(w, fds[s]))
+                w->failed = 1;
+        }
+    }
+
+out:
+    while(opened-- > 0)
+        close(fds[opened]);
+    free(fds);
+    return NULL;
+}
+
+static int compare_ns(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_us(const struct latencies *l, double p) {
+    size_t i = (size_t)(p * (double)(l->len - 1) + 0.5);
+
+    return l->ns[i] / 1000.0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-t threads] [-s sessions per thread] "
+            "[-g games per session] [-S seed] [-d device]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    struct worker *workers;
+    struct latencies all[NR_CMDS];
+    unsigned long games = 0, commands = 0;
+    uint64_t start, elapsed;
+    double secs;
+    int opt, i, k, failed = 0;
+
+    while((opt = getopt(argc, argv, "t:s:g:S:d:h")) != -1) {
+        switch(opt) {
+            case 't':
+                nr_threads = atoi(optarg);
+                break;
+            case 's':
+                nr_sessions = atoi(optarg);
+                break;
+            case 'g':
+                nr_games = atoi(optarg);
+                break;
+            case 'S':
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'd':
+                device = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(nr_threads < 1 || nr_sessions < 1 || nr_games < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(!(workers = calloc(nr_threads, sizeof(*workers)))) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    start = now_ns();
+    for(i = 0; i < nr_threads; ++i) {
+        workers[i].id = i;
+        /* never zero, xorshift would stay there */
+        workers[i].rng = (seed + (uint64_t)i) * 0x9e3779b97f4a7c15ULL | 1;
+        if(pthread_create(&workers[i].thread, NULL, run_worker,
+                          &workers[i])) {
+            fprintf(stderr, "Cannot start thread %d\n", i);
+            return 1;
+        }
+    }
+
+    for(i = 0; i < nr_threads; ++i)
+        pthread_join(workers[i].thread, NULL);
+    elapsed = now_ns() - start;
+    secs = elapsed / 1e9;
+
+    /* Merge every thread's samples per command type. */
+    memset(all, 0, sizeof(all));
+    for(i = 0; i < nr_threads; ++i) {
+        failed |= workers[i].failed;
+        games += workers[i].games;
+        commands += workers[i].commands;
+
+        for(k = 0; k < NR_CMDS; ++k) {
+            struct latencies *l = &workers[i].lat[k];
+            size_t n;
+
+            for(n = 0; n < l->len; ++n) {
+                if(add_latency(&all[k], l->ns[n])) {
+                    fprintf(stderr, "Out of memory\n");
+                    return 1;
+                }
+            }
+            free(l->ns);
+        }
+    }
+
+    printf("threads %d sessions %d games/session %d seed %llu\n",
+           nr_threads, nr_threads * nr_sessions, nr_games,
+           (unsigned long long)seed);
+    printf("games %lu in %.3f s, %.1f games/s\n", games, secs, games / secs);
+    printf("commands %lu, %.1f commands/s\n", commands, commands / secs);
+    printf("%-4s %10s %12s %12s %12s %12s\n", "cmd", "count", "p50 us",
+           "p99 us", "p999 us", "max us");
+
+    for(k = 0; k < NR_CMDS; ++k) {
+        if(!all[k].len)
+            continue;
+
+        qsort(all[k].ns, all[k].len, sizeof(*all[k].ns), compare_ns);
+        printf("%-4s %10zu %12.1f %12.1f %12.1f %12.1f\n", cmd_names[k],
+               all[k].len, percentile_us(&all[k], 0.50),
+               percentile_us(&all[k], 0.99), percentile_us(&all[k], 0.999),
+               all[k].ns[all[k].len - 1] / 1000.0);
+        free(all[k].ns);
+    }
+
+    free(workers);
+    return failed;
+}
@@ -0,0 +1,293 @@
+/* file: reversi-engine-bench.c
+* description: Microbenchmarks of the reversi engine built in user space
+*	(module/libreversi.a), no module or root needed. Checks perft from
+*	the starting position against the known counts, then times move
+*	generation, move making, evaluation, midgame search and the exact
+*	endgame solver over positions from seeded random games, so runs are
+*	comparable from one build to the next and can go under perf or a
+*	sanitizer. Exits non-zero when a perft count is wrong.
+*
+*	build and run: make -C module bench
+*	options: -S seed, -e evaluation weights file, -d search depth,
+*	         -n endgame empties, -p perft depth
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "reversi_engine.h"
+
+#define NR_POSITIONS    4096
+#define MOVEGEN_ROUNDS  500
+#define EVAL_ROUNDS     200
+#define NR_SEARCHES     8
+#define NR_SOLVES       8
+#define PERFT_KNOWN     12
+
+/* positions after n plies from the start, a forced pass counting as a ply */
+static const u64 perft_counts[PERFT_KNOWN + 1] = {
+    1ULL, 4ULL, 12ULL, 56ULL, 244ULL, 1396ULL, 8200ULL, 55092ULL, 390216ULL,
+    3005288ULL, 24571284ULL, 212258800ULL, 1939886636ULL
+};
+
+struct position {
+    struct reversi_board board;
+    int player;
+};
+
+static struct position positions[NR_POSITIONS];
+static struct position endgames[NR_SOLVES];
+static u64 rng;
+static volatile u64 sink;   /* keeps the timed loops from being optimised away */
+
+static u64 next_random(void) {
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545f4914f6cdd1dULL;
+}
+
+static double seconds(u64 start) {
+    return (ktime_get_ns() - start) / 1e9;
+}
+
+/* Play random moves from the start until empties squares are left or the
+   game ends. Returns 0 once there, with the side to move in pos. */
+static int random_game(struct position *pos, int empties) {
+    u64 moves;
+    int player = PLAYER_BLACK, n, i;
+
+    setupBoard(&pos->board);
+    while(BOARDSIZE - hweight64(pos->board.discs[PLAYER_BLACK] |
+                                pos->board.discs[PLAYER_WHITE]) > empties) {
+        if(!(moves = tallyLegalMoves(player, &pos->board))) {
+            player = OPPONENT(player);
+            if(!(moves = tallyLegalMoves(player, &pos->board)))
+                return -1;
+        }
+
+        n = next_random() % hweight64(moves);
+        for(i = 0; i < n; ++i)
+            moves &= moves - 1;
+        makeYourMove(__ffs64(moves), player, &pos->board);
+        player = OPPONENT(player);
+    }
+
+    if(!tallyLegalMoves(player, &pos->board))
+        player = OPPONENT(player);
+    pos->player = player;
+    return hweight64(tallyLegalMoves(player, &pos->board)) >= 2 ? 0 : -1;
+}
+
+static void make_positions(int endgame_empties) {
+    int i;
+
+    /* anywhere from the opening to the late midgame */
+    for(i = 0; i < NR_POSITIONS; ++i) {
+        while(random_game(&positions[i], 20 + next_random() % 38))
+            ;
+    }
+
+    for(i = 0; i < NR_SOLVES; ++i) {
+        while(random_game(&endgames[i], endgame_empties))
+            ;
+    }
+}
+
+static void bench_movegen(void) {
+    const struct reversi_board *b;
+    u64 start, acc = 0;
+    long ops = 0;
+    int r, i;
+
+    start = ktime_get_ns();
+    for(r = 0; r < MOVEGEN_ROUNDS; ++r) {
+        for(i = 0; i < NR_POSITIONS; ++i, ++ops) {
+            b = &positions[i].board;
+            acc += findLegalMoves(b->discs[positions[i].player],
+                                  b->discs[OPPONENT(positions[i].player)]);
+        }
+    }
+    sink = acc;
+    printf("findLegalMoves   %10.1f M/s\n", ops / seconds(start) / 1e6);
+}
+
+static void bench_makemove(void) {
+    struct reversi_board child;
+    u64 start, moves, acc = 0;
+    long ops = 0;
+    int r, i;
+
+    start = ktime_get_ns();
+    for(r = 0; r < MOVEGEN_ROUNDS / 10; ++r) {
+        for(i = 0; i < NR_POSITIONS; ++i) {
+            moves = tallyLegalMoves(positions[i].player, &positions[i].board);
+            for(; moves; moves &= moves - 1, ++ops) {
+                child = positions[i].board;
+                makeYourMove(__ffs64(moves), positions[i].player, &child);
+                acc += child.hash;
+            }
+        }
+    }
+    sink = acc;
+    printf("makeYourMove     %10.1f M/s\n", ops / seconds(start) / 1e6);
+}
+
+static void bench_eval(void) {
+    u64 start;
+    long ops = 0;
+    int r, i, acc = 0;
+
+    start = ktime_get_ns();
+    for(r = 0; r < EVAL_ROUNDS; ++r) {
+        for(i = 0; i < NR_POSITIONS; ++i, ++ops)
+            acc += evaluateBoard(positions[i].player, &positions[i].board);
+    }
+    sink = acc;
+    printf("evaluateBoard    %10.1f M/s\n", ops / seconds(start) / 1e6);
+}
+
+static void bench_search(unsigned int depth) {
+    struct reversi_search search;
+    u64 start, nodes = 0;
+    int i;
+
+    start = ktime_get_ns();
+    for(i = 0; i < NR_SEARCHES; ++i) {
+        initSearch(&search, 0, 0, depth);
+        deepenSearch(&search, &positions[i * (NR_POSITIONS / NR_SEARCHES)].board,
+                     positions[i * (NR_POSITIONS / NR_SEARCHES)].player, 1);
+        nodes += search.nodes;
+    }
+    printf("search depth %-3u %10.1f M nodes/s, %llu nodes in %.3f s\n",
+           depth, nodes / seconds(start) / 1e6, (unsigned long long)nodes,
+           seconds(start));
+}
+
+static void bench_endgame(int empties) {
+    struct reversi_search search;
+    u64 start, nodes = 0;
+    int i;
+
+    start = ktime_get_ns();
+    for(i = 0; i < NR_SOLVES; ++i) {
+        initSearch(&search, 0, 0, BOARDSIZE);
+        solveBestMove(&search, &endgames[i].board, endgames[i].player);
+        nodes += search.nodes;
+    }
+    printf("solve %2d empties %10.1f M nodes/s, %.1f ms each\n", empties,
+           nodes / seconds(start) / 1e6, seconds(start) * 1e3 / NR_SOLVES);
+}
+
+/* Check move generation against the known counts, timing the deepest. */
+static int bench_perft(int depth) {
+    struct reversi_board start;
+    u64 t = 0, leaves = 0;
+    int d, bad = 0;
+
+    setupBoard(&start);
+    for(d = 1; d <= depth; ++d) {
+        t = ktime_get_ns();
+        leaves = perft(NULL, &start, PLAYER_BLACK, d, 0);
+        if(leaves != perft_counts[d]) {
+            fprintf(stderr, "perft %d: %llu, expected %llu\n", d,
+                    (unsigned long long)leaves,
+                    (unsigned long long)perft_counts[d]);
+            bad = 1;
+        }
+    }
+
+    printf("perft %-2d         %10.1f M/s, %llu positions in %.3f s%s\n",
+           depth, leaves / seconds(t) / 1e6, (unsigned long long)leaves,
+           seconds(t), bad ? ", WRONG" : "");
+    return bad;
+}
+
+static int load_weights(const char *path) {
+    FILE *fp;
+    u8 *data;
+    long size;
+    int err;
+
+    if(!(fp = fopen(path, "rb"))) {
+        perror(path);
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    if(size < 0 || !(data = malloc(size)) ||
+       fread(data, 1, size, fp) != (size_t)size) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    err = parseEvalWeights(data, size);
+    free(data);
+    if(err) {
+        fprintf(stderr, "%s is not an evaluation weights file\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *weights = NULL;
+    unsigned int depth = 8;
+    int opt, empties = 14, perft_depth = 9, bad;
+
+    rng = 1;
+    while((opt = getopt(argc, argv, "S:e:d:n:p:")) != -1) {
+        switch(opt) {
+            case 'S':
+                rng = strtoull(optarg, NULL, 0) | 1;
+                break;
+            case 'e':
+                weights = optarg;
+                break;
+            case 'd':
+                depth = atoi(optarg);
+                break;
+            case 'n':
+                empties = atoi(optarg);
+                break;
+            case 'p':
+                perft_depth = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-S seed] [-e weights] "
+                        "[-d depth] [-n endgame empties] [-p perft depth]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    if(perft_depth < 1 || perft_depth > PERFT_KNOWN) {
+        fprintf(stderr, "perft depth must be 1 to %d\n", PERFT_KNOWN);
+        return 1;
+    }
+
+    initZobrist();
+    initPatterns();
+    if(initTransTable(16))
+        fprintf(stderr, "No transposition table, searching without one\n");
+    if(weights && load_weights(weights))
+        return 1;
+
+    make_positions(empties);
+    printf("evaluation: %s\n", weights ? weights : "square weights");
+    bad = bench_perft(perft_depth);
+    bench_movegen();
+    bench_makemove();
+    bench_eval();
+    bench_search(depth);
+    bench_endgame(empties);
+
+    freeEngineTables();
+    return bad;
+}